@@ -15,16 +15,46 @@
 #include <memory>
 #include <fstream>
 #include <cctype>
+#include <list>
+#include <unordered_map>
+#include <chrono>
+#include <map>
+#include <functional>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <random>
+#include <cmath>
+#include <filesystem>
 
 using namespace std;
 
+// ------------------------------
+// Funkcje czasTeraz / ustawStalyCzas
+// Zwracają bieżący czas używany w całym programie. Przy nagrywaniu i odtwarzaniu
+// sesji zegar jest zatrzymany na stałej wartości, żeby wyniki były powtarzalne.
+// ------------------------------
+time_t& stalyCzas() {
+    static time_t czas = 0; // 0 = zegar systemowy
+    return czas;
+}
+
+void ustawStalyCzas(time_t czas) { stalyCzas() = czas; }
+
+time_t czasTeraz() {
+    return stalyCzas() != 0 ? stalyCzas() : time(0);
+}
+
 // ------------------------------
 // Funkcja aktualnaData
 // Zwraca aktualną datę w formacie "DD.MM.RRRR" jako string.
 // Używana do zapisywania dat wypożyczeń i kar.
 // ------------------------------
 string aktualnaData() {
-    time_t t = time(0);
+    time_t t = czasTeraz();
     tm* now = localtime(&t);
     stringstream ss;
     ss << setw(2) << setfill('0') << now->tm_mday << "."
@@ -45,10 +75,495 @@ string formatujDate(time_t czas) {
     return ss.str();
 }
 
+// ------------------------------
+// Funkcja formatujDateGodzine
+// Zamienia czas typu time_t na string w formacie "DD.MM.RRRR GG:MM".
+// Używana tam, gdzie termin liczy się co do godziny (np. odbiór rezerwacji).
+// ------------------------------
+string formatujDateGodzine(time_t czas) {
+    tm* czasTM = localtime(&czas);
+    stringstream ss;
+    ss << put_time(czasTM, "%d.%m.%Y %H:%M");
+    return ss.str();
+}
+
+// ------------------------------
+// Funkcje naCzas / naKwote
+// Bezpieczna konwersja pól wczytanych z pliku (string -> time_t / double).
+// W razie błędu zwracają odpowiednio bieżący czas lub 0.
+// ------------------------------
+time_t naCzas(const string& s) {
+    try { return static_cast<time_t>(stoll(s)); } catch (...) { return czasTeraz(); }
+}
+
+double naKwote(const string& s) {
+    try { return stod(s); } catch (...) { return 0.0; }
+}
+
+// ------------------------------
+// Funkcja sha256
+// Zwraca skrót SHA-256 podanych danych (32 bajty).
+// Używana do haszowania haseł (patrz skrotHasla).
+// ------------------------------
+string sha256(const string& dane) {
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+    auto obrot = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    string blok = dane;
+    uint64_t bity = static_cast<uint64_t>(dane.size()) * 8;
+    blok += static_cast<char>(0x80);
+    while (blok.size() % 64 != 56) blok += '\0';
+    for (int i = 7; i >= 0; --i) blok += static_cast<char>((bity >> (i * 8)) & 0xff);
+
+    for (size_t poczatek = 0; poczatek < blok.size(); poczatek += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (static_cast<uint32_t>(static_cast<unsigned char>(blok[poczatek + i * 4])) << 24) |
+                   (static_cast<uint32_t>(static_cast<unsigned char>(blok[poczatek + i * 4 + 1])) << 16) |
+                   (static_cast<uint32_t>(static_cast<unsigned char>(blok[poczatek + i * 4 + 2])) << 8) |
+                   static_cast<uint32_t>(static_cast<unsigned char>(blok[poczatek + i * 4 + 3]));
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = obrot(w[i - 15], 7) ^ obrot(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = obrot(w[i - 2], 17) ^ obrot(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = hh + (obrot(e, 6) ^ obrot(e, 11) ^ obrot(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            uint32_t t2 = (obrot(a, 2) ^ obrot(a, 13) ^ obrot(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            hh = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+    }
+    string wynik;
+    for (uint32_t slowo : h) {
+        for (int i = 3; i >= 0; --i) wynik += static_cast<char>((slowo >> (i * 8)) & 0xff);
+    }
+    return wynik;
+}
+
+// ------------------------------
+// Funkcja naHex
+// Zamienia bajty na zapis szesnastkowy.
+// ------------------------------
+string naHex(const string& bajty) {
+    static const char cyfry[] = "0123456789abcdef";
+    string wynik;
+    for (unsigned char b : bajty) {
+        wynik += cyfry[b >> 4];
+        wynik += cyfry[b & 0x0f];
+    }
+    return wynik;
+}
+
+// ------------------------------
+// Funkcja skrotHasla
+// Celowo kosztowne wyprowadzenie skrótu hasła: 2^koszt iteracji SHA-256
+// po soli i haśle. Zwraca rekord "$s256$koszt$sól$skrót" do zapisania w pliku.
+// ------------------------------
+string skrotHasla(const string& haslo, const string& sol, int koszt) {
+    string h = sha256(sol + haslo);
+    for (unsigned long i = 1; i < (1UL << koszt); ++i) {
+        h = sha256(h + sol + haslo);
+    }
+    return "$s256$" + to_string(koszt) + "$" + sol + "$" + naHex(h);
+}
+
+// ------------------------------
+// Funkcja rowneStalyCzas
+// Porównuje napisy w czasie zależnym tylko od długości (nie od miejsca pierwszej różnicy).
+// ------------------------------
+bool rowneStalyCzas(const string& a, const string& b) {
+    unsigned char roznica = a.size() == b.size() ? 0 : 1;
+    for (size_t i = 0; i < a.size(); ++i) {
+        roznica |= static_cast<unsigned char>(a[i] ^ (i < b.size() ? b[i] : 0));
+    }
+    return roznica == 0;
+}
+
+// ------------------------------
+// Funkcje numerDnia / sekundaDnia / dniSpoznienia
+// Dni wypożyczenia to pełne doby (po 24 godziny) od chwili wypożyczenia -
+// bez względu na strefę czasową i godzinę wypożyczenia.
+// Przegląd przetrzymań (obliczKaryWsadowo) trzyma czas wypożyczenia jako dwie
+// liczby 32-bitowe: numer doby od 1.01.1970 i sekundę w tej dobie, i liczy
+// z nich dokładnie to samo co dniSpoznienia.
+// ------------------------------
+inline int32_t numerDnia(time_t czas) {
+    return static_cast<int32_t>(czas / (60 * 60 * 24));
+}
+
+inline int32_t sekundaDnia(time_t czas) {
+    return static_cast<int32_t>(czas % (60 * 60 * 24));
+}
+
+inline int dniSpoznienia(time_t czasWypozyczenia, time_t teraz, int maxDni) {
+    int dni = static_cast<int>((teraz - czasWypozyczenia) / (60 * 60 * 24)) - maxDni;
+    return dni > 0 ? dni : 0;
+}
+
+// ------------------------------
+// Funkcja obliczKaryWsadowo
+// Jądro przeglądu przetrzymań: dla spakowanych tablic czasów wypożyczenia (numer doby
+// i sekunda w dobie) wylicza karę z jednego progu (w groszach) na chwilę 'dzis'/'sekundaDzis'.
+// Pełne doby od wypożyczenia to różnica numerów dób minus jeden, jeśli dzisiejsza
+// doba jeszcze nie doszła do godziny wypożyczenia. Pętla działa tylko na liczbach
+// 32-bitowych i nie ma w niej skoków, więc kompilator ją wektoryzuje
+// (g++ -O2/-O3, sprawdzone przez -fopt-info-vec). Wolne egzemplarze mają dzień
+// BRAK_DNIA, który nigdy nie daje kary. BRAK_DNIA jest na tyle mały, a odDni z kary.cfg
+// ograniczone (PolitykaKar::MAKS_DNI), że odejmowanie w pętli nie przepełnia int32. Próg może być podany w czasie działania
+// (ParametryProgu) albo jako stałe (PolitykaKar::ProgStaly) - wtedy kompilator
+// wstawia je do pętli jak przy zasadach wpisanych na sztywno.
+// ------------------------------
+struct ParametryProgu {
+    int32_t odDni;  // Od ilu dni od wypożyczenia naliczana jest kara
+    int32_t stawka; // Groszy za każdy dzień ponad odDni
+    int32_t limit;  // Maksymalna kwota w groszach (INT32_MAX = bez limitu)
+};
+
+constexpr int32_t BRAK_DNIA = INT32_MAX / 2;
+
+template <typename Prog>
+void obliczKaryWsadowo(const int32_t* dni, const int32_t* sekundy, size_t ile, int32_t dzis, int32_t sekundaDzis,
+                       const Prog& prog, int32_t* kwoty) {
+    const int32_t odDni = prog.odDni, stawka = prog.stawka, limit = prog.limit;
+    // Ograniczenie liczby dni chroni mnożenie przed przepełnieniem
+    const int32_t maksDni = INT32_MAX / (stawka > 0 ? stawka : 1);
+    for (size_t i = 0; i < ile; ++i) {
+        int32_t d = dzis - dni[i] - (sekundaDzis < sekundy[i]) - odDni;
+        d = d > 0 ? d : 0;
+        d = d < maksDni ? d : maksDni;
+        int32_t kara = d * stawka;
+        kwoty[i] = kara < limit ? kara : limit;
+    }
+}
+
+// ------------------------------
+// Klasa PolitykaKar
+// Zasady naliczania kar za przetrzymanie jako płaska tabela progów.
+// Próg nalicza stawkę za każdy dzień ponad odDni od wypożyczenia (z opcjonalnym limitem).
+// Pierwszy próg to okres bez kary - od niego liczone są "dni spóźnienia".
+// Domyślne zasady: 1 zł/dzień po 14 dniach i dodatkowo 1 zł/dzień po 30 dniach.
+// Zasady można nadpisać plikiem kary.cfg, wiersze: prog;odDni;stawka;limit;powod
+// (odDni 0-MAKS_DNI, stawka i limit 0-MAKS_KWOTA zł - wiersze poza zakresem są pomijane).
+// Dopóki obowiązują zasady domyślne, kary liczone są ze stałych (bez przechodzenia
+// po tabeli progów), a przegląd przetrzymań dostaje je w czasie kompilacji.
+// ------------------------------
+struct ProgKary {
+    int odDni;     // Od ilu dni od wypożyczenia naliczana jest kara
+    double stawka; // Kwota za każdy dzień ponad odDni
+    double limit;  // Maksymalna kwota kary (0 = bez limitu)
+    string powod;  // Powód zapisywany w karze
+};
+
+class PolitykaKar {
+private:
+    static constexpr int DOMYSLNY_OKRES = 14;       // Dni bez kary
+    static constexpr double DOMYSLNA_STAWKA = 1.0;  // zł za dzień po okresie bez kary
+    static constexpr int DOMYSLNY_PROG_MIESIAC = 30;
+    static constexpr double DOMYSLNA_STAWKA_MIESIAC = 1.0;
+
+    vector<ProgKary> progi; // Progi posortowane rosnąco po odDni
+    bool domyslna = true;   // Czy obowiązują zasady domyślne (nie wczytano kary.cfg)
+
+public:
+    static constexpr int MAKS_DNI = 36500;          // Największe odDni progu (100 lat)
+    static constexpr double MAKS_KWOTA = 1000000.0; // Największa stawka i limit (zł) - w groszach mieszczą się w int32
+
+    // Powód kary za przetrzymanie w zasadach domyślnych (i we wszystkich starszych danych)
+    static constexpr const char* DOMYSLNY_POWOD = "Przetrzymanie powyżej 14 dni";
+
+    // Próg jako stałe czasu kompilacji dla jądra obliczKaryWsadowo (kwoty w groszach)
+    template <int32_t OdDni, int32_t Stawka>
+    struct ProgStaly {
+        static constexpr int32_t odDni = OdDni;
+        static constexpr int32_t stawka = Stawka;
+        static constexpr int32_t limit = INT32_MAX;
+    };
+    using ProgDomyslny = ProgStaly<DOMYSLNY_OKRES, static_cast<int32_t>(DOMYSLNA_STAWKA * 100)>;
+    using ProgDomyslnyMiesiac = ProgStaly<DOMYSLNY_PROG_MIESIAC, static_cast<int32_t>(DOMYSLNA_STAWKA_MIESIAC * 100)>;
+
+    // Kara z danego progu według zasad domyślnych
+    static constexpr double karaDomyslna(size_t prog, int dniOdWypozyczenia) {
+        return prog == 0 ? (dniOdWypozyczenia > DOMYSLNY_OKRES ? (dniOdWypozyczenia - DOMYSLNY_OKRES) * DOMYSLNA_STAWKA : 0.0)
+                         : (dniOdWypozyczenia > DOMYSLNY_PROG_MIESIAC
+                                ? (dniOdWypozyczenia - DOMYSLNY_PROG_MIESIAC) * DOMYSLNA_STAWKA_MIESIAC : 0.0);
+    }
+
+    PolitykaKar() {
+        progi = {
+            {DOMYSLNY_OKRES, DOMYSLNA_STAWKA, 0.0, DOMYSLNY_POWOD},
+            {DOMYSLNY_PROG_MIESIAC, DOMYSLNA_STAWKA_MIESIAC, 0.0, "Przetrzymanie powyżej miesiąca"}
+        };
+    }
+
+    // Zasady obowiązujące w całym programie
+    static PolitykaKar& aktualna() {
+        static PolitykaKar polityka;
+        return polityka;
+    }
+
+    const vector<ProgKary>& getProgi() const { return progi; }
+    bool isDomyslna() const { return domyslna; }
+    int getOkresBezKary() const { return progi.front().odDni; }
+    const string& getPowodPrzetrzymania() const { return progi.front().powod; }
+
+    // Próg w groszach dla jądra obliczKaryWsadowo
+    ParametryProgu getParametry(size_t prog) const {
+        const ProgKary& p = progi[prog];
+        auto naGrosze = [](double zl) {
+            return static_cast<int32_t>(min<long long>(llround(zl * 100), INT32_MAX));
+        };
+        return {p.odDni, naGrosze(p.stawka), p.limit > 0 ? naGrosze(p.limit) : INT32_MAX};
+    }
+
+    // Kwota kary z danego progu dla wypożyczenia trwającego dniOdWypozyczenia dni
+    double obliczKare(size_t prog, int dniOdWypozyczenia) const {
+        if (domyslna) return karaDomyslna(prog, dniOdWypozyczenia);
+        const ProgKary& p = progi[prog];
+        int dni = dniOdWypozyczenia - p.odDni;
+        if (dni <= 0) return 0.0;
+        double kara = dni * p.stawka;
+        return (p.limit > 0 && kara > p.limit) ? p.limit : kara;
+    }
+
+    // Wczytuje progi z pliku. Jeśli plik nie istnieje lub nie ma poprawnych progów,
+    // zostają zasady domyślne.
+    void wczytaj(const string& sciezka) {
+        ifstream plik(sciezka);
+        if (!plik) return;
+        vector<ProgKary> nowe;
+        string linia;
+        while (getline(plik, linia)) {
+            if (linia.rfind("prog;", 0) != 0) continue;
+            stringstream ss(linia.substr(5));
+            string odDni, stawka, limit, powod;
+            getline(ss, odDni, ';');
+            getline(ss, stawka, ';');
+            getline(ss, limit, ';');
+            getline(ss, powod);
+            try {
+                ProgKary p{stoi(odDni), stod(stawka), limit.empty() ? 0.0 : stod(limit), powod};
+                // Warunki zapisane tak, żeby odrzucały też NaN
+                if (p.odDni < 0 || p.odDni > MAKS_DNI || !(p.stawka >= 0 && p.stawka <= MAKS_KWOTA) ||
+                    !(p.limit >= 0 && p.limit <= MAKS_KWOTA) || powod.empty()) {
+                    continue;
+                }
+                nowe.push_back(p);
+            } catch (...) {
+                // Niepoprawny wiersz pomijamy
+            }
+        }
+        if (nowe.empty()) return;
+        stable_sort(nowe.begin(), nowe.end(),
+                    [](const ProgKary& a, const ProgKary& b) { return a.odDni < b.odDni; });
+        progi = nowe;
+        domyslna = false;
+    }
+};
+
+static_assert(PolitykaKar::karaDomyslna(0, 14) == 0.0 && PolitykaKar::karaDomyslna(0, 20) == 6.0 &&
+              PolitykaKar::karaDomyslna(1, 40) == 10.0, "Zasady domyślne: 1 zł/dzień po 14 i po 30 dniach");
+static_assert(static_cast<int64_t>(BRAK_DNIA) + PolitykaKar::MAKS_DNI + 1 <= static_cast<int64_t>(INT32_MAX) + 1,
+              "obliczKaryWsadowo: dzis - BRAK_DNIA - 1 - odDni musi się mieścić w int32");
+
+// ------------------------------
+// Struktura Ustawienia
+// Ustawienia działania programu z pliku ustawienia.cfg, wiersze: nazwa;wartosc
+//   limitWczytanych;64 - ile rekordów wypożyczeń czytelników trzymać naraz w pamięci
+//   kosztHasla;12      - koszt haszowania nowych haseł (0-24, 2^koszt iteracji)
+// Nieznane nazwy i niepoprawne wartości są pomijane - zostają wartości domyślne.
+// ------------------------------
+struct Ustawienia {
+    size_t limitWczytanych = 64;
+    int kosztHasla = 12;
+
+    void wczytaj(const string& sciezka) {
+        ifstream plik(sciezka);
+        string linia;
+        while (getline(plik, linia)) {
+            size_t srednik = linia.find(';');
+            if (srednik == string::npos) continue;
+            string nazwa = linia.substr(0, srednik);
+            string wartosc = linia.substr(srednik + 1);
+            try {
+                if (nazwa == "limitWczytanych" && stoll(wartosc) >= 1) {
+                    limitWczytanych = static_cast<size_t>(stoll(wartosc));
+                } else if (nazwa == "kosztHasla" && stoi(wartosc) >= 0 && stoi(wartosc) <= 24) {
+                    kosztHasla = stoi(wartosc);
+                }
+            } catch (...) {
+                // Niepoprawną wartość pomijamy
+            }
+        }
+    }
+};
+
+// ------------------------------
+// Klasa DziennikZmian
+// Dziennik zmian katalogu i użytkowników dla procesów tylko do odczytu (kiosk).
+// Każda zmiana jest dopisywana jako wiersz "numer;czas;TYP;pola..." z rosnącym numerem.
+// Przy zapisie danych dziennik jest czyszczony, a numer ostatniej zmiany trafia
+// do pliku biblioteka.txt (wiersz SEQ) - kiosk wczytuje plik i dalej czyta dziennik.
+// ------------------------------
+class DziennikZmian {
+private:
+    string sciezka;               // Plik dziennika (pusty = dziennik wyłączony)
+    unsigned long long numer = 0; // Numer ostatniej opublikowanej zmiany
+
+public:
+    // Dziennik używany w całym programie
+    static DziennikZmian& aktualny() {
+        static DziennikZmian dziennik;
+        return dziennik;
+    }
+
+    // Otwiera dziennik. Zmiany o numerach większych niż numer z pliku danych zostały
+    // po awarii (program nie zapisał danych) - nie ma ich w danych, więc trzeba je odrzucić.
+    // Numeracja idzie wtedy dalej z pominięciem jednego numeru: kiosk, który zdążył
+    // zastosować odrzucone zmiany, zobaczy lukę i wczyta dane od nowa.
+    // Zwraca liczbę odrzuconych zmian.
+    size_t otworz(const string& sciezka, unsigned long long ostatniNumer) {
+        this->sciezka = sciezka;
+        numer = ostatniNumer;
+        size_t odrzucone = 0;
+        ifstream plik(sciezka);
+        string linia;
+        while (getline(plik, linia)) {
+            try {
+                unsigned long long n = stoull(linia);
+                if (n > ostatniNumer) ++odrzucone;
+                numer = max(numer, n);
+            } catch (...) {
+                // Uszkodzony wiersz pomijamy
+            }
+        }
+        if (odrzucone > 0) ++numer;
+        return odrzucone;
+    }
+
+    unsigned long long getNumer() const { return numer; }
+
+    // Dopisuje zmianę do dziennika
+    void publikuj(const string& zdarzenie) {
+        publikuj(vector<string>{zdarzenie});
+    }
+
+    // Dopisuje kilka zmian jednym zapisem (np. całe wypożyczenie kilku książek)
+    void publikuj(const vector<string>& zdarzenia) {
+        if (sciezka.empty() || zdarzenia.empty()) return;
+        time_t teraz = czasTeraz();
+        stringstream ss;
+        for (const auto& zdarzenie : zdarzenia) {
+            ss << ++numer << ";" << teraz << ";" << zdarzenie << "\n";
+        }
+        ofstream plik(sciezka, ios::app);
+        plik << ss.str();
+    }
+
+    // Czyści dziennik po zapisaniu pełnych danych
+    void wyczysc() {
+        if (sciezka.empty()) return;
+        ofstream plik(sciezka, ios::trunc);
+    }
+};
+
+// ------------------------------
+// Klasa RaportPamieci
+// Zestawienie pamięci zajmowanej przez dane programu: liczba obiektów i bajty
+// w podziale na kategorie. Liczone przejściem po strukturach danych (bez własnego
+// alokatora), więc narzut samego alokatora sterty nie jest wliczany, a rozmiary
+// bloków kontrolnych shared_ptr i węzłów tablic haszujących są szacunkowe.
+// ------------------------------
+class RaportPamieci {
+public:
+    enum Kategoria { KSIAZKA, CZYTELNIK, BIBLIOTEKARZ, WYPOZYCZENIE, KARA, NAPISY, NARZUT, LICZBA_KATEGORII };
+
+    // Blok kontrolny shared_ptr utworzonego przez make_shared (wskaźnik vtable i dwa liczniki)
+    static constexpr size_t BLOK_KONTROLNY = sizeof(void*) + 2 * sizeof(int);
+
+private:
+    size_t obiekty[LICZBA_KATEGORII] = {};
+    size_t bajty[LICZBA_KATEGORII] = {};
+    size_t zapas = 0;         // Niewykorzystana pojemność wektorów i napisów (odzyskuje ją shrink)
+    size_t niewczytanych = 0; // Czytelnicy, których wypożyczenia są tylko w pliku (patrz Czytelnik)
+
+public:
+    void dodaj(Kategoria kategoria, size_t ileObiektow, size_t ileBajtow) {
+        obiekty[kategoria] += ileObiektow;
+        bajty[kategoria] += ileBajtow;
+    }
+
+    // Dolicza bufor napisu na stercie (krótkie napisy mieszczą się w samym obiekcie string)
+    void dodajNapis(const string& napis) {
+        static const size_t wbudowany = string().capacity();
+        if (napis.capacity() <= wbudowany) return;
+        dodaj(NAPISY, 1, napis.capacity() + 1);
+        zapas += napis.capacity() - napis.size();
+    }
+
+    // Dolicza tablicę wektora: elementy do podanej kategorii, niewykorzystaną pojemność do narzutu
+    template <typename T>
+    void dodajWektor(const vector<T>& wektor, Kategoria kategoria) {
+        dodaj(kategoria, wektor.size(), wektor.size() * sizeof(T));
+        size_t wolne = (wektor.capacity() - wektor.size()) * sizeof(T);
+        if (wektor.capacity() > 0) dodaj(NARZUT, 1, wolne);
+        zapas += wolne;
+    }
+
+    void dodajNiewczytanego() { ++niewczytanych; }
+
+    size_t getSuma() const {
+        size_t suma = 0;
+        for (size_t b : bajty) suma += b;
+        return suma;
+    }
+    size_t getZapas() const { return zapas; }
+
+    // Wypisuje raport w postaci tabeli
+    void wypisz(ostream& wyjscie) const {
+        static const char* nazwy[LICZBA_KATEGORII] = {
+            "Ksiazka", "Czytelnik", "Bibliotekarz", "Wypozyczenie", "Kara",
+            "Napisy (bufory na stercie)", "Narzut kontenerów"};
+        ios::fmtflags flagi = wyjscie.flags();
+        streamsize precyzja = wyjscie.precision();
+        size_t suma = getSuma();
+        wyjscie << left << setw(30) << "Kategoria" << right << setw(10) << "Obiekty"
+                << setw(14) << "Bajty" << setw(9) << "Udział" << "\n";
+        for (int k = 0; k < LICZBA_KATEGORII; ++k) {
+            wyjscie << left << setw(30) << nazwy[k] << right << setw(10) << obiekty[k]
+                    << setw(14) << bajty[k] << setw(8) << fixed << setprecision(1)
+                    << (suma > 0 ? 100.0 * bajty[k] / suma : 0.0) << "%\n";
+        }
+        wyjscie << left << setw(40) << "Razem" << right << setw(14) << suma
+                << " (" << setprecision(1) << suma / 1024.0 << " KiB)\n"
+                << "W tym niewykorzystana pojemność: " << zapas << " B (do odzyskania przez shrink)\n";
+        if (niewczytanych > 0) {
+            wyjscie << "Czytelnicy z niewczytanymi wypożyczeniami: " << niewczytanych
+                    << " (ich wypożyczenia i kary są tylko w pliku)\n";
+        }
+        wyjscie.flags(flagi);
+        wyjscie.precision(precyzja);
+    }
+};
+
 // ------------------------------
 // Klasa Kara
 // Reprezentuje karę nałożoną na czytelnika za przetrzymanie książki lub inną przewinę.
 // Przechowuje kwotę, powód, datę nałożenia i status zapłaty.
+// Kary naliczane automatycznie za przetrzymanie trwającego wypożyczenia są oznaczone,
+// żeby nie naliczać ich drugi raz niezależnie od treści powodu.
 // ------------------------------
 class Kara {
 private:
@@ -56,17 +571,31 @@ private:
     string powod;         // Powód nałożenia kary
     string dataNalozenia; // Data nałożenia kary
     bool czyZaplacona;    // Czy kara została zapłacona
+    bool automatyczna;    // Czy naliczona automatycznie za przetrzymanie (patrz naliczKaryZaPrzetrzymanie)
 
 public:
     // Konstruktor kary. Jeśli nie podano daty, ustawia dzisiejszą.
-    Kara(double kwota = 0.0, string powod = "", string data = "", bool zaplacona = false)
+    Kara(double kwota = 0.0, string powod = "", string data = "", bool zaplacona = false, bool automatyczna = false)
         : kwota(kwota), powod(powod), dataNalozenia(data.empty() ? aktualnaData() : data),
-          czyZaplacona(zaplacona) {}
+          czyZaplacona(zaplacona), automatyczna(automatyczna) {}
 
     double getKwota() const { return kwota; }
     string getPowod() const { return powod; }
     string getData() const { return dataNalozenia; }
     bool isZaplacona() const { return czyZaplacona; }
+    bool isAutomatyczna() const { return automatyczna; }
+
+    // Dolicza napisy kary do raportu (sam obiekt liczy wektor, w którym leży)
+    void policzPamiec(RaportPamieci& raport) const {
+        raport.dodajNapis(powod);
+        raport.dodajNapis(dataNalozenia);
+    }
+
+    // Zwalnia niewykorzystaną pojemność napisów kary
+    void zmniejszPamiec() {
+        powod.shrink_to_fit();
+        dataNalozenia.shrink_to_fit();
+    }
 
     // Oznacza karę jako zapłaconą
     void zaplac() { czyZaplacona = true; }
@@ -84,45 +613,416 @@ public:
 // ------------------------------
 // Klasa Ksiazka
 // Reprezentuje książkę w katalogu biblioteki.
-// Przechowuje tytuł, autora, numer i status wypożyczenia.
+// Przechowuje tytuł, autora, numer, status wypożyczenia oraz login i czas wypożyczającego.
+// Zwrócony egzemplarz zarezerwowanego tytułu jest odkładany dla następnej osoby w kolejce.
 // ------------------------------
 class Ksiazka {
 private:
-    string tytul;      // Tytuł książki
-    string autor;      // Autor książki
-    string numer;      // Numer książki 
-    bool wypozyczona;  // Czy książka jest wypożyczona
+    string tytul;        // Tytuł książki
+    string autor;        // Autor książki
+    string numer;        // Numer książki 
+    bool wypozyczona;    // Czy książka jest wypożyczona
+    string wypozyczajacy; // Login czytelnika, który ma książkę (pusty, jeśli nieznany)
+    time_t czasWypozyczenia; // Kiedy ten czytelnik wypożyczył egzemplarz (0 = nieznany)
+    string odlozonaDla;   // Login czytelnika, dla którego odłożono egzemplarz (pusty = nie odłożona)
+    time_t czasOdlozenia; // Kiedy egzemplarz odłożono
 
 public:
     // Konstruktor książki
-    Ksiazka(string tytul = "", string autor = "", string numer = "", bool wypozyczona = false)
-        : tytul(tytul), autor(autor), numer(numer), wypozyczona(wypozyczona) {}
+    Ksiazka(string tytul = "", string autor = "", string numer = "", bool wypozyczona = false,
+            string wypozyczajacy = "", string odlozonaDla = "", time_t czasOdlozenia = 0,
+            time_t czasWypozyczenia = 0)
+        : tytul(tytul), autor(autor), numer(numer), wypozyczona(wypozyczona),
+          wypozyczajacy(wypozyczona ? wypozyczajacy : ""),
+          czasWypozyczenia(wypozyczona ? czasWypozyczenia : 0),
+          odlozonaDla(wypozyczona ? "" : odlozonaDla), czasOdlozenia(czasOdlozenia) {}
 
     string getTytul() const { return tytul; }
     string getAutor() const { return autor; }
     string getNumer() const { return numer; }
     bool isWypozyczona() const { return wypozyczona; }
+    string getWypozyczajacy() const { return wypozyczajacy; }
+    time_t getCzasWypozyczenia() const { return czasWypozyczenia; }
+    string getOdlozonaDla() const { return odlozonaDla; }
+    time_t getCzasOdlozenia() const { return czasOdlozenia; }
+
+    // Dolicza napisy książki do raportu (sam obiekt liczy katalog)
+    void policzPamiec(RaportPamieci& raport) const {
+        raport.dodajNapis(tytul);
+        raport.dodajNapis(autor);
+        raport.dodajNapis(numer);
+        raport.dodajNapis(wypozyczajacy);
+        raport.dodajNapis(odlozonaDla);
+    }
 
-    void wypozycz() { wypozyczona = true; }
-    void zwroc() { wypozyczona = false; }
+    // Zwalnia niewykorzystaną pojemność napisów książki
+    void zmniejszPamiec() {
+        tytul.shrink_to_fit();
+        autor.shrink_to_fit();
+        numer.shrink_to_fit();
+        wypozyczajacy.shrink_to_fit();
+        odlozonaDla.shrink_to_fit();
+    }
+
+    // Czy czytelnik o podanym loginie może teraz wypożyczyć ten egzemplarz
+    bool isDostepnaDla(const string& login) const {
+        return !wypozyczona && (odlozonaDla.empty() || odlozonaDla == login);
+    }
+
+    void wypozycz(const string& login = "", time_t czas = 0) {
+        wypozyczona = true;
+        wypozyczajacy = login;
+        czasWypozyczenia = czas;
+        odlozonaDla.clear();
+        czasOdlozenia = 0;
+    }
+    void zwroc() { wypozyczona = false; wypozyczajacy.clear(); czasWypozyczenia = 0; }
+    void odloz(const string& login, time_t czas) { odlozonaDla = login; czasOdlozenia = czas; }
+    void zwolnijOdlozenie() { odlozonaDla.clear(); czasOdlozenia = 0; }
 
     // Wyświetla informacje o książce
     void wyswietlInformacje() const {
         cout << "Tytuł: " << tytul << "\n"
              << "Autor: " << autor << "\n"
              << "Numer: " << numer << "\n"
-             << "Status: " << (wypozyczona ? "Wypożyczona" : "Dostępna") << "\n\n";
+             << "Status: " << (wypozyczona ? "Wypożyczona" : !odlozonaDla.empty() ? "Odłożona dla rezerwującego" : "Dostępna")
+             << "\n\n";
+    }
+};
+
+// ------------------------------
+// Funkcja parsujKsiazke
+// Tworzy książkę z wiersza sekcji KSIAZKI pliku biblioteka.txt
+// ("tytul;autor;numer;wypozyczona;login;odlozonaDla;czasOdlozenia;czasWypozyczenia" -
+// ostatnie pola mogą nie występować w starszych plikach).
+// ------------------------------
+Ksiazka parsujKsiazke(const string& linia) {
+    stringstream ss(linia);
+    string tytul, autor, numer, wyp, login, odlozonaDla, czasOdlozenia, czasWypozyczenia;
+    getline(ss, tytul, ';');
+    getline(ss, autor, ';');
+    getline(ss, numer, ';');
+    getline(ss, wyp, ';');
+    getline(ss, login, ';');
+    getline(ss, odlozonaDla, ';');
+    getline(ss, czasOdlozenia, ';');
+    getline(ss, czasWypozyczenia, ';');
+    return Ksiazka(tytul, autor, numer, wyp == "1", login, odlozonaDla,
+                   odlozonaDla.empty() ? 0 : naCzas(czasOdlozenia),
+                   czasWypozyczenia.empty() ? 0 : naCzas(czasWypozyczenia));
+}
+
+// ------------------------------
+// Funkcja tytulKsiazki
+// Zwraca tytuł książki o podanym ID (do wyświetlania wypożyczeń i kar).
+// ID książki to jej pozycja w katalogu + 1 - katalog jest tylko rozszerzany, więc ID się nie zmienia.
+// ID 0 oznacza wypożyczenie bez książki, do którego dopisywane są kary administracyjne.
+// ------------------------------
+string tytulKsiazki(const vector<Ksiazka>& katalog, int id) {
+    if (id == 0) return "Kara administracyjna";
+    if (id < 0 || static_cast<size_t>(id) > katalog.size()) return "Nieznana książka";
+    return katalog[id - 1].getTytul();
+}
+
+// ------------------------------
+// Klasa TerminyWypozyczen
+// Spakowany indeks aktywnych wypożyczeń całej biblioteki, po ID egzemplarza:
+// tablice czasów wypożyczenia (numer doby i sekunda w dobie, int32), mapa bitowa wypożyczonych egzemplarzy
+// i mapa bitowa wypożyczeń z naliczoną (niezapłaconą) karą za przetrzymanie.
+// Jest aktualizowany przy wypożyczeniu i zwrocie, więc przegląd przetrzymań
+// nie wczytuje rekordów czytelników - jądro obliczKaryWsadowo liczy kolejne bloki
+// po 64 egzemplarze, a bloki bez żadnego wypożyczenia są pomijane.
+// ------------------------------
+class TerminyWypozyczen {
+private:
+    static constexpr size_t BLOK = 64; // Egzemplarzy na jedno słowo mapy bitowej
+
+    vector<int32_t> dni;          // Numer doby wypożyczenia (BRAK_DNIA dla wolnych), długość - wielokrotność BLOK
+    vector<int32_t> sekundy;      // Sekunda doby, o której wypożyczono egzemplarz
+    vector<uint64_t> wypozyczone; // Bit na egzemplarz: czy jest wypożyczony
+    vector<uint64_t> naliczone;   // Bit na egzemplarz: czy wypożyczenie ma niezapłaconą karę automatyczną
+    size_t ksiazek = 0;           // Ile egzemplarzy obejmuje indeks
+
+public:
+    // Jedno przetrzymane wypożyczenie w wyniku przeglądu
+    struct Przetrzymanie {
+        int idKsiazki;     // ID egzemplarza
+        int dniSpoznienia; // Dni ponad okres bez kary
+        double kara;       // Kara ze wszystkich progów na dziś (zł)
+    };
+
+    // Indeks używany w całym programie
+    static TerminyWypozyczen& aktualne() {
+        static TerminyWypozyczen terminy;
+        return terminy;
+    }
+
+    // Buduje indeks od nowa ze statusu książek w katalogu
+    void zbuduj(const vector<Ksiazka>& katalog) {
+        dni.clear();
+        sekundy.clear();
+        wypozyczone.clear();
+        naliczone.clear();
+        ksiazek = 0;
+        for (size_t i = 0; i < katalog.size(); ++i) {
+            dodajKsiazke();
+            if (katalog[i].isWypozyczona()) wypozycz(static_cast<int>(i) + 1, katalog[i].getCzasWypozyczenia());
+        }
+    }
+
+    // Robi miejsce na egzemplarz dopisany na koniec katalogu
+    void dodajKsiazke() {
+        if (++ksiazek > dni.size()) {
+            dni.resize(dni.size() + BLOK, BRAK_DNIA);
+            sekundy.resize(sekundy.size() + BLOK, 0);
+            wypozyczone.push_back(0);
+            naliczone.push_back(0);
+        }
+    }
+
+    // Zapisuje wypożyczenie egzemplarza (czas 0 = nieznany, egzemplarz nie będzie uznany za przetrzymany)
+    void wypozycz(int id, time_t czas) {
+        if (id <= 0 || static_cast<size_t>(id) > ksiazek) return;
+        size_t i = static_cast<size_t>(id) - 1;
+        // Czas spoza zakresu (uszkodzony plik) traktujemy jak nieznany
+        bool znany = czas > 0 && czas / (60 * 60 * 24) < BRAK_DNIA;
+        dni[i] = znany ? numerDnia(czas) : BRAK_DNIA;
+        sekundy[i] = znany ? sekundaDnia(czas) : 0;
+        wypozyczone[i / BLOK] |= 1ULL << (i % BLOK);
+    }
+
+    void zwroc(int id) {
+        if (id <= 0 || static_cast<size_t>(id) > ksiazek) return;
+        size_t i = static_cast<size_t>(id) - 1;
+        dni[i] = BRAK_DNIA;
+        sekundy[i] = 0;
+        wypozyczone[i / BLOK] &= ~(1ULL << (i % BLOK));
+        naliczone[i / BLOK] &= ~(1ULL << (i % BLOK));
+    }
+
+    // Zapamiętuje, czy wypożyczenie egzemplarza ma niezapłaconą karę automatyczną
+    // (zapisywane w pliku danych, żeby przegląd po uruchomieniu nie wczytywał jego czytelnika)
+    void ustawNaliczona(int id, bool naliczona) {
+        if (id <= 0 || static_cast<size_t>(id) > ksiazek) return;
+        size_t i = static_cast<size_t>(id) - 1;
+        if (naliczona) naliczone[i / BLOK] |= 1ULL << (i % BLOK);
+        else naliczone[i / BLOK] &= ~(1ULL << (i % BLOK));
+    }
+
+    bool isNaliczona(int id) const {
+        if (id <= 0 || static_cast<size_t>(id) > ksiazek) return false;
+        size_t i = static_cast<size_t>(id) - 1;
+        return (naliczone[i / BLOK] >> (i % BLOK)) & 1;
+    }
+
+    // Dolicza tablice indeksu do raportu pamięci
+    void policzPamiec(RaportPamieci& raport) const {
+        raport.dodajWektor(dni, RaportPamieci::NARZUT);
+        raport.dodajWektor(sekundy, RaportPamieci::NARZUT);
+        raport.dodajWektor(wypozyczone, RaportPamieci::NARZUT);
+        raport.dodajWektor(naliczone, RaportPamieci::NARZUT);
+    }
+
+    // Przegląd przetrzymań całej biblioteki na dzień 'teraz' według aktualnej polityki kar
+    vector<Przetrzymanie> przetrzymane(time_t teraz) const {
+        const PolitykaKar& polityka = PolitykaKar::aktualna();
+        vector<ParametryProgu> progi;
+        if (!polityka.isDomyslna()) {
+            for (size_t p = 0; p < polityka.getProgi().size(); ++p) progi.push_back(polityka.getParametry(p));
+        }
+        const int32_t dzis = numerDnia(teraz);
+        const int32_t sekundaDzis = sekundaDnia(teraz);
+        const int32_t okres = polityka.getOkresBezKary();
+
+        vector<Przetrzymanie> wynik;
+        int32_t kwoty[BLOK];
+        int64_t suma[BLOK];
+        for (size_t blok = 0; blok < wypozyczone.size(); ++blok) {
+            uint64_t bity = wypozyczone[blok];
+            if (bity == 0) continue;
+            const int32_t* dniBloku = &dni[blok * BLOK];
+            const int32_t* sekundyBloku = &sekundy[blok * BLOK];
+            fill(begin(suma), end(suma), 0);
+            auto dolicz = [&](const auto& prog) {
+                obliczKaryWsadowo(dniBloku, sekundyBloku, BLOK, dzis, sekundaDzis, prog, kwoty);
+                for (size_t i = 0; i < BLOK; ++i) suma[i] += kwoty[i];
+            };
+            if (polityka.isDomyslna()) {
+                dolicz(PolitykaKar::ProgDomyslny());
+                dolicz(PolitykaKar::ProgDomyslnyMiesiac());
+            } else {
+                for (const auto& prog : progi) dolicz(prog);
+            }
+            for (size_t i = 0; i < BLOK; ++i) {
+                if (!((bity >> i) & 1) || dniBloku[i] == BRAK_DNIA) continue;
+                int spoznienie = dzis - dniBloku[i] - (sekundaDzis < sekundyBloku[i]) - okres;
+                if (spoznienie <= 0) continue;
+                wynik.push_back({static_cast<int>(blok * BLOK + i) + 1, spoznienie, suma[i] / 100.0});
+            }
+        }
+        return wynik;
+    }
+};
+
+// ------------------------------
+// Klasa Rezerwacje
+// Kolejki rezerwacji (FIFO) dla tytułów, których wszystkie egzemplarze są zajęte.
+// Zwrócony egzemplarz od razu trafia do pierwszej osoby w kolejce (jest dla niej odkładany).
+// Odłożenie, po które nikt nie przyjdzie w ciągu DNI_ODLOZENIA dni (co do godziny,
+// patrz terminOdbioru), przechodzi na następną osobę.
+// ------------------------------
+class Rezerwacje {
+private:
+    unordered_map<string, deque<string>> kolejki; // Tytuł -> loginy w kolejności rezerwacji
+    vector<int> odlozone;                         // ID egzemplarzy odłożonych dla czytelników
+
+public:
+    static constexpr int DNI_ODLOZENIA = 3; // Ile dni egzemplarz czeka na odbiór
+
+    // Rezerwacje używane w całym programie
+    static Rezerwacje& aktualne() {
+        static Rezerwacje rezerwacje;
+        return rezerwacje;
+    }
+
+    void wyczysc() {
+        kolejki.clear();
+        odlozone.clear();
+    }
+
+    const vector<int>& getOdlozone() const { return odlozone; }
+
+    // Do kiedy odłożony egzemplarz czeka na odbiór - ten sam termin jest
+    // pokazywany czytelnikowi i sprawdzany przy zwalnianiu odłożeń
+    static time_t terminOdbioru(time_t czasOdlozenia) {
+        return czasOdlozenia + DNI_ODLOZENIA * 60 * 60 * 24;
+    }
+
+    // Dolicza kolejki do raportu pamięci (węzły tablicy haszującej i bloki deque szacunkowo)
+    void policzPamiec(RaportPamieci& raport) const {
+        raport.dodaj(RaportPamieci::NARZUT, kolejki.size(),
+                     kolejki.bucket_count() * sizeof(void*) +
+                     kolejki.size() * (2 * sizeof(void*) + sizeof(pair<const string, deque<string>>)));
+        for (const auto& wpis : kolejki) {
+            raport.dodajNapis(wpis.first);
+            raport.dodaj(RaportPamieci::NARZUT, 0, wpis.second.size() * sizeof(string));
+            for (const auto& login : wpis.second) raport.dodajNapis(login);
+        }
+        raport.dodajWektor(odlozone, RaportPamieci::NARZUT);
+    }
+
+    void zmniejszPamiec() {
+        for (auto& wpis : kolejki) {
+            wpis.second.shrink_to_fit();
+            for (auto& login : wpis.second) login.shrink_to_fit();
+        }
+        odlozone.shrink_to_fit();
+    }
+
+    // Dopisuje czytelnika na koniec kolejki; zwraca jego miejsce (0 jeśli już w niej był)
+    size_t dodaj(const string& tytul, const string& login) {
+        auto& kolejka = kolejki[tytul];
+        if (find(kolejka.begin(), kolejka.end(), login) != kolejka.end()) return 0;
+        kolejka.push_back(login);
+        return kolejka.size();
+    }
+
+    // Usuwa czytelnika z kolejki; zwraca false, jeśli go w niej nie było
+    bool anuluj(const string& tytul, const string& login) {
+        auto it = kolejki.find(tytul);
+        if (it == kolejki.end()) return false;
+        auto pozycja = find(it->second.begin(), it->second.end(), login);
+        if (pozycja == it->second.end()) return false;
+        it->second.erase(pozycja);
+        if (it->second.empty()) kolejki.erase(it);
+        return true;
+    }
+
+    // Rezerwacje czytelnika: tytuł i miejsce w kolejce
+    vector<pair<string, size_t>> rezerwacjeCzytelnika(const string& login) const {
+        vector<pair<string, size_t>> wynik;
+        for (const auto& wpis : kolejki) {
+            auto pozycja = find(wpis.second.begin(), wpis.second.end(), login);
+            if (pozycja != wpis.second.end()) {
+                wynik.emplace_back(wpis.first, static_cast<size_t>(pozycja - wpis.second.begin()) + 1);
+            }
+        }
+        sort(wynik.begin(), wynik.end());
+        return wynik;
+    }
+
+    // Odkłada wolny egzemplarz dla pierwszej osoby w kolejce jego tytułu.
+    // Zwraca login tej osoby lub pusty napis, jeśli nikt nie czeka.
+    string przekaz(vector<Ksiazka>& katalog, int id, time_t teraz) {
+        Ksiazka& ksiazka = katalog[id - 1];
+        auto it = kolejki.find(ksiazka.getTytul());
+        if (it == kolejki.end()) return "";
+        string login = it->second.front();
+        it->second.pop_front();
+        if (it->second.empty()) kolejki.erase(it);
+        ksiazka.odloz(login, teraz);
+        odlozone.push_back(id);
+        return login;
+    }
+
+    // Zapamiętuje egzemplarz odłożony w danych wczytanych z pliku
+    void dodajOdlozenie(int id) { odlozone.push_back(id); }
+
+    // Usuwa egzemplarz z listy odłożonych (np. gdy rezerwujący go wypożyczył)
+    void usunOdlozenie(int id) {
+        odlozone.erase(remove(odlozone.begin(), odlozone.end(), id), odlozone.end());
+    }
+
+    // Zwalnia odłożenia, po które nikt nie przyszedł, i przekazuje je dalej.
+    // Zwraca zdarzenia do dziennika zmian.
+    // Nie korzysta z TerminyWypozyczen::obliczKaryWsadowo: odłożonych jest najwyżej
+    // tyle egzemplarzy, ile leży na półce odbiorów (lista 'odlozone'), a termin
+    // liczy się co do godziny i jest pokazywany czytelnikowi - jądro liczy pełne dni.
+    vector<string> zwolnijWygasle(vector<Ksiazka>& katalog, time_t teraz) {
+        vector<string> zdarzenia;
+        vector<int> wygasle;
+        for (int id : odlozone) {
+            if (teraz >= terminOdbioru(katalog[id - 1].getCzasOdlozenia())) wygasle.push_back(id);
+        }
+        for (int id : wygasle) {
+            usunOdlozenie(id);
+            Ksiazka& ksiazka = katalog[id - 1];
+            ksiazka.zwolnijOdlozenie();
+            string nastepny = przekaz(katalog, id, teraz);
+            zdarzenia.push_back(nastepny.empty() ? "ZWOLNIENIE;" + ksiazka.getNumer()
+                                                 : "ODLOZENIE;" + ksiazka.getNumer() + ";" + nastepny);
+        }
+        return zdarzenia;
+    }
+
+    // Zapisuje kolejki w formacie pliku biblioteka.txt ("tytul;login1;login2;...")
+    void zapisz(ostream& plik) const {
+        for (const auto& wpis : kolejki) {
+            plik << wpis.first;
+            for (const auto& login : wpis.second) plik << ";" << login;
+            plik << "\n";
+        }
+    }
+
+    // Wczytuje jedną kolejkę z wiersza sekcji REZERWACJE
+    void wczytajWiersz(const string& linia) {
+        stringstream ss(linia);
+        string tytul, login;
+        getline(ss, tytul, ';');
+        while (getline(ss, login, ';')) {
+            if (!login.empty()) dodaj(tytul, login);
+        }
     }
 };
 
 // ------------------------------
 // Klasa Wypozyczenie
 // Reprezentuje pojedyncze wypożyczenie książki przez czytelnika.
-// Przechowuje tytuł książki, datę wypożyczenia, czas, status zwrotu i powiązane kary.
+// Przechowuje ID książki, datę wypożyczenia, czas, status zwrotu i powiązane kary.
 // ------------------------------
 class Wypozyczenie {
 private:
-    string tytulKsiazki;         // Tytuł wypożyczonej książki
+    int idKsiazki;               // ID wypożyczonej książki (0 = bez książki)
     string dataWypozyczenia;     // Data wypożyczenia
     time_t czasWypozyczenia;     // Czas wypożyczenia (do obliczania kar)
     bool zwrocona;               // Czy książka została zwrócona
@@ -130,11 +1030,11 @@ private:
 
 public:
     // Konstruktor wypożyczenia
-    Wypozyczenie(string tytul = "", string data = "", time_t czas = time(0), bool zwrot = false)
-        : tytulKsiazki(tytul), dataWypozyczenia(data.empty() ? aktualnaData() : data),
+    Wypozyczenie(int idKsiazki = 0, string data = "", time_t czas = czasTeraz(), bool zwrot = false)
+        : idKsiazki(idKsiazki), dataWypozyczenia(data.empty() ? aktualnaData() : data),
           czasWypozyczenia(czas), zwrocona(zwrot) {}
 
-    string getTytul() const { return tytulKsiazki; }
+    int getIdKsiazki() const { return idKsiazki; }
     string getDataWypozyczenia() const { return dataWypozyczenia; }
     time_t getCzasWypozyczenia() const { return czasWypozyczenia; }
     bool isZwrocona() const { return zwrocona; }
@@ -144,31 +1044,42 @@ public:
     void oznaczJakoZwrocona() { zwrocona = true; }
     void dodajKare(const Kara& kara) { kary.push_back(kara); }
 
+    // Dolicza napisy i kary wypożyczenia do raportu
+    void policzPamiec(RaportPamieci& raport) const {
+        raport.dodajNapis(dataWypozyczenia);
+        raport.dodajWektor(kary, RaportPamieci::KARA);
+        for (const auto& kara : kary) kara.policzPamiec(raport);
+    }
+
+    // Zwalnia niewykorzystaną pojemność listy kar i napisów
+    void zmniejszPamiec() {
+        dataWypozyczenia.shrink_to_fit();
+        kary.shrink_to_fit();
+        for (auto& kara : kary) kara.zmniejszPamiec();
+    }
+
     // Oblicza liczbę dni spóźnienia względem dozwolonego czasu wypożyczenia
-    int obliczDniSpoznienia(int maxDni) const {
+    int obliczDniSpoznienia(int maxDni, time_t teraz = czasTeraz()) const {
         if (zwrocona) return 0;
-        time_t teraz = time(0);
-        double sekundy = difftime(teraz, czasWypozyczenia);
-        int dni = static_cast<int>(sekundy / (60 * 60 * 24)) - maxDni;
-        return max(0, dni);
+        return dniSpoznienia(czasWypozyczenia, teraz, maxDni);
     }
 
-    // Oblicza wysokość kary za przetrzymanie książki powyżej 14 dni
-    double obliczKareZaPrzetrzymanie() const {
-        int dni = obliczDniSpoznienia(14);
-        return dni * 1.0; // 1 zł za dzień powyżej 14 dni
+    // Oblicza wysokość kary za przetrzymanie książki po okresie bez kary
+    double obliczKareZaPrzetrzymanie(time_t teraz = czasTeraz()) const {
+        if (zwrocona) return 0.0;
+        return PolitykaKar::aktualna().obliczKare(0, dniSpoznienia(czasWypozyczenia, teraz, 0));
     }
 
     // Wyświetla informacje o wypożyczeniu i ewentualnych karach
-    void wyswietlInformacje() const {
-        cout << "Książka: " << tytulKsiazki << "\n"
+    void wyswietlInformacje(const vector<Ksiazka>& katalog, time_t teraz = czasTeraz()) const {
+        cout << "Książka: " << tytulKsiazki(katalog, idKsiazki) << "\n"
              << "Data wypożyczenia: " << dataWypozyczenia << "\n"
              << "Status: " << (zwrocona ? "Zwrócona" : "Wypożyczona") << "\n";
         if (!zwrocona) {
-            int dniSpoznienia = obliczDniSpoznienia(14);
-            if (dniSpoznienia > 0) {
-                cout << "Dni spóźnienia: " << dniSpoznienia << "\n";
-                cout << "Kara za przetrzymanie: " << fixed << setprecision(2) << obliczKareZaPrzetrzymanie() << " zł\n";
+            int dni = obliczDniSpoznienia(PolitykaKar::aktualna().getOkresBezKary(), teraz);
+            if (dni > 0) {
+                cout << "Dni spóźnienia: " << dni << "\n";
+                cout << "Kara za przetrzymanie: " << fixed << setprecision(2) << obliczKareZaPrzetrzymanie(teraz) << " zł\n";
             }
         }
         if (!kary.empty()) {
@@ -186,15 +1097,20 @@ public:
 // ------------------------------
 // Klasa Uzytkownik
 // Klasa bazowa dla wszystkich użytkowników systemu (czytelnik, bibliotekarz).
-// Przechowuje login, hasło i rolę użytkownika.
+// Przechowuje login, skrót hasła i rolę użytkownika.
+// Hasło jest przechowywane jako rekord "$s256$koszt$sól$skrót" (patrz skrotHasla).
+// Starsze rekordy z hasłem jawnym są haszowane przy zalogowaniu lub zapisie danych.
 // ------------------------------
 class Uzytkownik {
 protected:
     string login; // Login użytkownika (email)
-    string haslo; // Hasło użytkownika
+    string haslo; // Skrót hasła (lub hasło jawne ze starszych danych)
     string rola;  // Rola użytkownika ("czytelnik" lub "bibliotekarz")
 
 public:
+    // Koszt haszowania nowych haseł (2^koszt iteracji)
+    static int kosztHasla;
+
     Uzytkownik(string login = "", string haslo = "", string rola = "")
         : login(login), haslo(haslo), rola(rola) {}
 
@@ -203,9 +1119,48 @@ public:
     string getLogin() const { return login; }
     string getRola() const { return rola; }
     string getHaslo() const { return haslo; }
+    bool isHasloZahaszowane() const { return haslo.rfind("$s256$", 0) == 0; }
+
+    // Ustawia nowe hasło, haszując je z nową losową solą
+    void ustawHaslo(const string& noweHaslo) {
+        static mutex blokada;
+        static mt19937_64 losowe{random_device{}()};
+        string sol;
+        {
+            lock_guard<mutex> lock(blokada);
+            uint64_t liczba = losowe();
+            sol = naHex(string(reinterpret_cast<const char*>(&liczba), sizeof(liczba)));
+        }
+        haslo = skrotHasla(noweHaslo, sol, kosztHasla);
+    }
 
+    // Sprawdza hasło. Kosztowne - logowanie wywołuje je w puli PulaWeryfikacji.
     bool sprawdzHaslo(const string& haslo) const {
-        return this->haslo == haslo;
+        if (!isHasloZahaszowane()) {
+            return rowneStalyCzas(this->haslo, haslo);
+        }
+        stringstream ss(this->haslo.substr(6));
+        string koszt, sol;
+        getline(ss, koszt, '$');
+        getline(ss, sol, '$');
+        int k = 0;
+        try { k = stoi(koszt); } catch (...) { return false; }
+        if (k < 0 || k > 24) return false;
+        return rowneStalyCzas(this->haslo, skrotHasla(haslo, sol, k));
+    }
+
+    // Dolicza użytkownika do raportu pamięci (klasy pochodne doliczają też sam obiekt)
+    virtual void policzPamiec(RaportPamieci& raport) const {
+        raport.dodajNapis(login);
+        raport.dodajNapis(haslo);
+        raport.dodajNapis(rola);
+    }
+
+    // Zwalnia niewykorzystaną pojemność napisów i kontenerów użytkownika
+    virtual void zmniejszPamiec() {
+        login.shrink_to_fit();
+        haslo.shrink_to_fit();
+        rola.shrink_to_fit();
     }
 
     // Wirtualne menu użytkownika (do nadpisania w klasach pochodnych)
@@ -213,6 +1168,173 @@ public:
     virtual void wyswietlMenu(vector<Ksiazka>&, vector<shared_ptr<Uzytkownik>>&) {}
 };
 
+int Uzytkownik::kosztHasla = 12;
+
+// ------------------------------
+// Klasa PulaWeryfikacji
+// Ograniczona pula wątków sprawdzających hasła, żeby kosztowne haszowanie
+// nie blokowało wątku obsługującego sesję. Kolejka ma ograniczoną długość -
+// przy jej zapełnieniu zlecający czeka, zamiast zużywać coraz więcej pamięci.
+// Przy poprawnym haśle zapisanym jawnie (starsze dane) od razu je haszuje.
+// Haszuje też w tle hasła jawne przed zapisem danych (zlecHaszowanie).
+// ------------------------------
+class PulaWeryfikacji {
+private:
+    struct Zadanie {
+        shared_ptr<Uzytkownik> uzytkownik;
+        string haslo;
+        promise<bool> wynik;
+        bool haszuj = false; // Zamiast sprawdzać hasło, haszuje hasło zapisane jawnie
+    };
+
+    vector<thread> watki;
+    deque<Zadanie> kolejka;
+    size_t maksKolejki;
+    mutex blokada;
+    condition_variable jestZadanie;
+    condition_variable jestMiejsce;
+    bool koniec = false;
+
+    void pracuj() {
+        while (true) {
+            Zadanie zadanie;
+            {
+                unique_lock<mutex> lock(blokada);
+                jestZadanie.wait(lock, [this] { return koniec || !kolejka.empty(); });
+                if (kolejka.empty()) return;
+                zadanie = move(kolejka.front());
+                kolejka.pop_front();
+            }
+            jestMiejsce.notify_one();
+            if (zadanie.haszuj) {
+                zadanie.uzytkownik->ustawHaslo(zadanie.uzytkownik->getHaslo());
+                zadanie.wynik.set_value(true);
+                continue;
+            }
+            bool poprawne = zadanie.uzytkownik->sprawdzHaslo(zadanie.haslo);
+            if (poprawne && !zadanie.uzytkownik->isHasloZahaszowane()) {
+                zadanie.uzytkownik->ustawHaslo(zadanie.haslo);
+            }
+            zadanie.wynik.set_value(poprawne);
+        }
+    }
+
+    // Wstawia zadanie do kolejki, czekając na wolne miejsce
+    future<bool> dodaj(Zadanie zadanie) {
+        future<bool> wynik = zadanie.wynik.get_future();
+        {
+            unique_lock<mutex> lock(blokada);
+            jestMiejsce.wait(lock, [this] { return kolejka.size() < maksKolejki; });
+            kolejka.push_back(move(zadanie));
+        }
+        jestZadanie.notify_one();
+        return wynik;
+    }
+
+public:
+    PulaWeryfikacji(size_t liczbaWatkow = max(1u, thread::hardware_concurrency()), size_t maksKolejki = 256)
+        : maksKolejki(maksKolejki) {
+        for (size_t i = 0; i < liczbaWatkow; ++i) {
+            watki.emplace_back(&PulaWeryfikacji::pracuj, this);
+        }
+    }
+
+    PulaWeryfikacji(const PulaWeryfikacji&) = delete;
+    PulaWeryfikacji& operator=(const PulaWeryfikacji&) = delete;
+
+    ~PulaWeryfikacji() {
+        {
+            lock_guard<mutex> lock(blokada);
+            koniec = true;
+        }
+        jestZadanie.notify_all();
+        for (auto& watek : watki) watek.join();
+    }
+
+    // Zleca sprawdzenie hasła; wynik będzie dostępny w zwróconym future
+    future<bool> zlec(shared_ptr<Uzytkownik> uzytkownik, const string& haslo) {
+        return dodaj(Zadanie{uzytkownik, haslo, promise<bool>()});
+    }
+
+    // Zleca zahaszowanie hasła zapisanego jawnie; future jest gotowy po zmianie hasła
+    future<bool> zlecHaszowanie(shared_ptr<Uzytkownik> uzytkownik) {
+        return dodaj(Zadanie{uzytkownik, "", promise<bool>(), true});
+    }
+};
+
+// ------------------------------
+// Klasa MagazynRekordow
+// Miejsce na dysku dla rekordów wypożyczeń (wiersze WI:/K:) czytelników, które nie
+// są wczytane do pamięci. Rekord z pliku danych jest czytany prosto z niego
+// (czytelnik pamięta tylko położenie i długość), a rekord zmieniony w pamięci
+// i zwolniony z niej trafia na koniec pliku zrzutu. Zapis danych przepisuje wszystkie
+// rekordy do nowego pliku danych i zaczyna plik zrzutu od nowa.
+// ------------------------------
+class MagazynRekordow {
+public:
+    // Położenie rekordu w pliku danych lub w pliku zrzutu
+    struct Polozenie {
+        streamoff pozycja = 0;
+        size_t dlugosc = 0;
+        bool wZrzucie = false;
+    };
+
+private:
+    string plikDanych;          // Plik danych, z którego czytane są rekordy
+    string plikZrzutu;          // Plik na rekordy zwolnione z pamięci po zmianach
+    ifstream dane;
+    fstream zrzut;              // Otwierany przy pierwszym zapisie
+    streamoff koniecZrzutu = 0; // Gdzie dopisać następny rekord
+
+public:
+    // Magazyn używany w całym programie
+    static MagazynRekordow& aktualny() {
+        static MagazynRekordow magazyn;
+        return magazyn;
+    }
+
+    // Zaczyna czytać rekordy z pliku danych; plik zrzutu (np. po awarii) jest usuwany
+    void otworz(const string& plikDanych, const string& plikZrzutu) {
+        if (zrzut.is_open()) zrzut.close();
+        this->plikDanych = plikDanych;
+        this->plikZrzutu = plikZrzutu;
+        remove(plikZrzutu.c_str());
+        koniecZrzutu = 0;
+        otworzDane();
+    }
+
+    // Zamyka i ponownie otwiera sam plik danych (na czas jego podmiany przy zapisie)
+    void zamknijDane() { dane.close(); }
+    void otworzDane() {
+        dane.close();
+        dane.clear();
+        dane.open(plikDanych, ios::binary);
+    }
+
+    string odczytaj(const Polozenie& polozenie) {
+        if (polozenie.dlugosc == 0) return "";
+        istream& plik = polozenie.wZrzucie ? static_cast<istream&>(zrzut) : dane;
+        plik.clear();
+        plik.seekg(polozenie.pozycja);
+        string rekord(polozenie.dlugosc, '\0');
+        plik.read(&rekord[0], static_cast<streamsize>(rekord.size()));
+        rekord.resize(static_cast<size_t>(plik.gcount()));
+        return rekord;
+    }
+
+    Polozenie zapisz(const string& rekord) {
+        if (rekord.empty()) return Polozenie();
+        if (!zrzut.is_open()) zrzut.open(plikZrzutu, ios::in | ios::out | ios::trunc | ios::binary);
+        zrzut.clear();
+        zrzut.seekp(koniecZrzutu);
+        zrzut.write(rekord.data(), static_cast<streamsize>(rekord.size()));
+        zrzut.flush();
+        Polozenie polozenie{koniecZrzutu, rekord.size(), true};
+        koniecZrzutu += static_cast<streamoff>(rekord.size());
+        return polozenie;
+    }
+};
+
 // ------------------------------
 // Klasa Czytelnik
 // Dziedziczy po Uzytkownik. Reprezentuje czytelnika biblioteki.
@@ -225,13 +1347,59 @@ private:
     string email;                      // Email czytelnika
     string telefon;                    // Telefon czytelnika
     vector<Wypozyczenie> wypozyczenia; // Lista wypożyczeń
+    vector<size_t> aktywne;            // Pozycje niezwróconych wypożyczeń w liście wypożyczeń
     double saldoKar;                   // Suma niezapłaconych kar
+    MagazynRekordow::Polozenie rekord; // Gdzie leżą wiersze WI:/K: (gdy rekord nie jest wczytany)
+    bool wczytany;                     // Czy wypożyczenia i kary są wczytane do pamięci
+    bool zmieniony;                    // Czy wczytany rekord różni się od zapisanego na dysku
+    list<Czytelnik*>::iterator pozycjaLRU; // Miejsce na liście wczytani (gdy naLiscie)
+    bool naLiscie = false;
+
+    // Czytelnicy z wczytanymi wypożyczeniami, od ostatnio używanego (LRU)
+    static list<Czytelnik*> wczytani;
+
+    // Przesuwa czytelnika na początek listy ostatnio używanych
+    void oznaczUzycie() {
+        if (naLiscie) {
+            wczytani.splice(wczytani.begin(), wczytani, pozycjaLRU);
+        } else {
+            wczytani.push_front(this);
+            pozycjaLRU = wczytani.begin();
+            naLiscie = true;
+        }
+    }
+
+    void zdejmijZListy() {
+        if (!naLiscie) return;
+        wczytani.erase(pozycjaLRU);
+        naLiscie = false;
+    }
+
+    // Zapisuje w indeksie terminów, które aktywne wypożyczenia mają niezapłaconą karę automatyczną
+    void odswiezNaliczone() const {
+        for (size_t i : aktywne) {
+            const auto& kary = wypozyczenia[i].getKary();
+            TerminyWypozyczen::aktualne().ustawNaliczona(
+                wypozyczenia[i].getIdKsiazki(),
+                any_of(kary.begin(), kary.end(), [](const Kara& k) { return k.isAutomatyczna() && !k.isZaplacona(); }));
+        }
+    }
 
 public:
+    // Ile rekordów czytelników może być jednocześnie wczytanych do pamięci
+    static size_t limitWczytanych;
+
     Czytelnik(string imie = "", string nazwisko = "", string email = "", string telefon = "",
               string login = "", string haslo = "", double saldo = 0.0)
         : Uzytkownik(login, haslo, "czytelnik"), imie(imie), nazwisko(nazwisko),
-          email(email), telefon(telefon), saldoKar(saldo) {}
+          email(email), telefon(telefon), saldoKar(saldo), wczytany(true), zmieniony(true) {}
+
+    Czytelnik(const Czytelnik&) = delete;
+    Czytelnik& operator=(const Czytelnik&) = delete;
+
+    ~Czytelnik() override {
+        zdejmijZListy();
+    }
 
     string getImie() const { return imie; }
     string getNazwisko() const { return nazwisko; }
@@ -239,27 +1407,176 @@ public:
     string getTelefon() const { return telefon; }
     double getSaldoKar() const { return saldoKar; }
     void setSaldoKar(double saldo) { saldoKar = saldo; }
-    vector<Wypozyczenie>& getWypozyczenia() { return wypozyczenia; }
+    bool isWczytany() const { return wczytany; }
+    // Wersja do zmian - rekord trzeba będzie zapisać przy zwolnieniu z pamięci
+    vector<Wypozyczenie>& getWypozyczenia() { wczytajWypozyczenia(); zmieniony = true; return wypozyczenia; }
     const vector<Wypozyczenie>& getWypozyczenia() const { return wypozyczenia; }
+    const vector<size_t>& getAktywneWypozyczenia() { wczytajWypozyczenia(); return aktywne; }
 
     void dodajWypozyczenie(const Wypozyczenie& wypozyczenie) {
+        wczytajWypozyczenia();
         wypozyczenia.push_back(wypozyczenie);
+        if (!wypozyczenie.isZwrocona()) aktywne.push_back(wypozyczenia.size() - 1);
+        zmieniony = true;
+    }
+
+    // Zapamiętuje, gdzie na dysku leżą wiersze wypożyczeń czytelnika.
+    // Zostaną wczytane dopiero przy pierwszym użyciu (np. po zalogowaniu).
+    void ustawRekord(const MagazynRekordow::Polozenie& polozenie) {
+        vector<Wypozyczenie>().swap(wypozyczenia);
+        vector<size_t>().swap(aktywne);
+        rekord = polozenie;
+        wczytany = false;
+        zmieniony = false;
+        zdejmijZListy();
+    }
+
+    // Po zapisie danych rekord leży w nowym pliku (wczytany rekord zostaje w pamięci)
+    void ustawPolozenieRekordu(const MagazynRekordow::Polozenie& polozenie) {
+        rekord = polozenie;
+        zmieniony = false;
+    }
+
+    // Zwraca wypożyczenia i kary w formacie pliku biblioteka.txt
+    string serializujWypozyczenia() const {
+        if (!wczytany) return MagazynRekordow::aktualny().odczytaj(rekord);
+        stringstream ss;
+        for (const auto& w : wypozyczenia) {
+            ss << "WI:" << w.getIdKsiazki() << ";" << w.getDataWypozyczenia() << ";" << w.isZwrocona() << ";" << w.getCzasWypozyczenia() << "\n";
+            for (const auto& kara : w.getKary()) {
+                ss << "K:" << kara.getKwota() << ";" << kara.getPowod() << ";" << kara.getData() << ";" << kara.isZaplacona()
+                   << ";" << kara.isAutomatyczna() << "\n";
+            }
+        }
+        return ss.str();
+    }
+
+    // Wczytuje wypożyczenia z dysku (jeśli nie są w pamięci) i nalicza zaległe kary.
+    // Jeśli wczytanych rekordów jest więcej niż limit, zwalnia najdawniej używane.
+    void wczytajWypozyczenia() {
+        if (!wczytany) wczytajRekord();
+        oznaczUzycie();
+        while (wczytani.size() > limitWczytanych && wczytani.back() != this) {
+            wczytani.back()->zwolnijWypozyczenia();
+        }
+    }
+
+    // Zwalnia wypożyczenia z pamięci; zmieniony rekord jest najpierw zapisywany do pliku zrzutu
+    void zwolnijWypozyczenia() {
+        if (!wczytany) return;
+        if (zmieniony) rekord = MagazynRekordow::aktualny().zapisz(serializujWypozyczenia());
+        vector<Wypozyczenie>().swap(wypozyczenia);
+        vector<size_t>().swap(aktywne);
+        wczytany = false;
+        zmieniony = false;
+        zdejmijZListy();
+    }
+
+private:
+    void wczytajRekord() {
+        stringstream tekst(MagazynRekordow::aktualny().odczytaj(rekord));
+        string linia;
+        while (getline(tekst, linia)) {
+            if (!linia.empty() && linia.back() == '\r') linia.pop_back();
+            if (linia.rfind("WI:", 0) == 0) {
+                stringstream ss(linia.substr(3));
+                string id, data, zwrot, czas;
+                getline(ss, id, ';');
+                getline(ss, data, ';');
+                getline(ss, zwrot, ';');
+                getline(ss, czas, ';');
+                int idKsiazki = 0;
+                try { idKsiazki = stoi(id); } catch (...) { idKsiazki = 0; }
+                wypozyczenia.emplace_back(idKsiazki, data, naCzas(czas), zwrot == "1");
+                if (zwrot != "1") aktywne.push_back(wypozyczenia.size() - 1);
+            } else if (linia.rfind("K:", 0) == 0 && !wypozyczenia.empty()) {
+                stringstream ss(linia.substr(2));
+                string kwota, powod, data, zapl, automatyczna;
+                getline(ss, kwota, ';');
+                getline(ss, powod, ';');
+                getline(ss, data, ';');
+                getline(ss, zapl, ';');
+                // Starsze rekordy nie mają znacznika - kary automatyczne poznajemy po powodzie
+                bool czyAutomatyczna = getline(ss, automatyczna, ';')
+                    ? automatyczna == "1"
+                    : powod == PolitykaKar::DOMYSLNY_POWOD || powod == PolitykaKar::aktualna().getPowodPrzetrzymania();
+                wypozyczenia.back().dodajKare(Kara(naKwote(kwota), powod, data, zapl == "1", czyAutomatyczna));
+            }
+        }
+        wczytany = true;
+        zmieniony = false;
+        naliczKaryZaPrzetrzymanie();
+        odswiezNaliczone();
+    }
+
+public:
+
+    void policzPamiec(RaportPamieci& raport) const override {
+        raport.dodaj(RaportPamieci::CZYTELNIK, 1, sizeof(Czytelnik));
+        Uzytkownik::policzPamiec(raport);
+        raport.dodajNapis(imie);
+        raport.dodajNapis(nazwisko);
+        raport.dodajNapis(email);
+        raport.dodajNapis(telefon);
+        if (!wczytany) raport.dodajNiewczytanego();
+        raport.dodajWektor(wypozyczenia, RaportPamieci::WYPOZYCZENIE);
+        for (const auto& w : wypozyczenia) w.policzPamiec(raport);
+        raport.dodajWektor(aktywne, RaportPamieci::NARZUT);
+    }
+
+    void zmniejszPamiec() override {
+        Uzytkownik::zmniejszPamiec();
+        imie.shrink_to_fit();
+        nazwisko.shrink_to_fit();
+        email.shrink_to_fit();
+        telefon.shrink_to_fit();
+        wypozyczenia.shrink_to_fit();
+        for (auto& w : wypozyczenia) w.zmniejszPamiec();
+        aktywne.shrink_to_fit();
+    }
+
+    // Automatycznie nalicza kary za przetrzymanie niezwróconych książek
+    // (przegląd całej biblioteki bez wczytywania rekordów robi TerminyWypozyczen)
+    void naliczKaryZaPrzetrzymanie() {
+        const PolitykaKar& polityka = PolitykaKar::aktualna();
+        time_t teraz = czasTeraz();
+        for (size_t i : aktywne) {
+            auto& wyp = wypozyczenia[i];
+            double kara = wyp.obliczKareZaPrzetrzymanie(teraz);
+            if (kara <= 0) continue;
+            // Sprawdź, czy kara już nie została naliczona (powód mógł się zmienić w kary.cfg)
+            bool juzNaliczona = false;
+            for (const auto& k : wyp.getKary()) {
+                if (k.isAutomatyczna() && !k.isZaplacona()) {
+                    juzNaliczona = true;
+                    break;
+                }
+            }
+            if (!juzNaliczona) {
+                wyp.dodajKare(Kara(kara, polityka.getPowodPrzetrzymania(), "", false, true));
+                saldoKar += kara;
+                zmieniony = true;
+                TerminyWypozyczen::aktualne().ustawNaliczona(wyp.getIdKsiazki(), true);
+                DziennikZmian::aktualny().publikuj("KARA;" + login + ";" + to_string(kara) + ";" + polityka.getPowodPrzetrzymania());
+            }
+        }
     }
 
     // Wyświetla historię wypożyczeń czytelnika
-    void wyswietlWypozyczenia() const {
+    void wyswietlWypozyczenia(const vector<Ksiazka>& katalog) const {
         if (wypozyczenia.empty()) {
             cout << "Brak historii wypożyczeń.\n";
             return;
         }
         cout << "\n=== HISTORIA WYPOSZCZEŃ ===\n";
+        time_t teraz = czasTeraz();
         for (const auto& wypozyczenie : wypozyczenia) {
-            wypozyczenie.wyswietlInformacje();
+            wypozyczenie.wyswietlInformacje(katalog, teraz);
         }
     }
 
     // Wyświetla listę kar czytelnika
-    void wyswietlKary() const {
+    void wyswietlKary(const vector<Ksiazka>& katalog) const {
         cout << "\n=== LISTA KAR ===\n";
         cout << "Suma kar: " << fixed << setprecision(2) << saldoKar << " zł\n\n";
         if (saldoKar <= 0) {
@@ -269,7 +1586,7 @@ public:
         for (const auto& wypozyczenie : wypozyczenia) {
             for (const auto& kara : wypozyczenie.getKary()) {
                 if (!kara.isZaplacona()) {
-                    cout << "- Książka: " << wypozyczenie.getTytul() << "\n";
+                    cout << "- Książka: " << tytulKsiazki(katalog, wypozyczenie.getIdKsiazki()) << "\n";
                     cout << "  Powód: " << kara.getPowod() << "\n";
                     cout << "  Kwota: " << fixed << setprecision(2) << kara.getKwota() << " zł\n";
                     cout << "  Data nałożenia: " << kara.getData() << "\n";
@@ -299,98 +1616,317 @@ public:
                 }
             }
         }
+        zmieniony = true;
+        odswiezNaliczone();
+        DziennikZmian::aktualny().publikuj("WPLATA;" + login + ";" + to_string(kwota));
         cout << "Zapłacono " << fixed << setprecision(2) << kwota << " zł. Pozostałe saldo kar: " << saldoKar << " zł.\n";
     }
 
     // Pozwala wypożyczyć książkę z katalogu
     void wypozyczKsiazke(vector<Ksiazka>& katalog) {
         cout << "\n=== WYPOŻYCZ KSIĄŻKĘ ===\n";
+        if (!wyswietlDostepne(katalog)) return;
+        cout << "Podaj tytuł książki do wypożyczenia: ";
+        string tytul;
+        getline(cin >> ws, tytul);
+        if (tytul.empty()) {
+            cout << "Tytuł nie może być pusty!\n";
+            return;
+        }
+        wypozyczKsiazki(katalog, {tytul});
+    }
+
+    // Pozwala wypożyczyć kilka książek naraz (wszystkie albo żadnej)
+    void wypozyczKilkaKsiazek(vector<Ksiazka>& katalog) {
+        cout << "\n=== WYPOŻYCZ KILKA KSIĄŻEK ===\n";
+        if (!wyswietlDostepne(katalog)) return;
+        vector<string> tytuly = wczytajTytuly("wypożyczenia");
+        if (tytuly.empty()) {
+            cout << "Nie podano żadnego tytułu.\n";
+            return;
+        }
+        wypozyczKsiazki(katalog, tytuly);
+    }
+
+    // Wypożycza wszystkie podane tytuły albo - jeśli któregoś brakuje - żaden.
+    // Dostępność wszystkich pozycji jest sprawdzana jednym przejściem po katalogu,
+    // dopiero potem dane są zmieniane, a zmiany trafiają do dziennika jednym zapisem.
+    bool wypozyczKsiazki(vector<Ksiazka>& katalog, const vector<string>& tytuly) {
+        // Dostępne egzemplarze żądanych tytułów (pierwszy w katalogu na końcu listy)
+        unordered_map<string, vector<size_t>> dostepne;
+        for (const auto& tytul : tytuly) dostepne[tytul];
+        for (size_t i = katalog.size(); i-- > 0;) {
+            if (!katalog[i].isDostepnaDla(login)) continue;
+            auto it = dostepne.find(katalog[i].getTytul());
+            if (it != dostepne.end()) it->second.push_back(i);
+        }
+        // Egzemplarz odłożony dla czytelnika idzie pierwszy, żeby nie zajmować
+        // wolnego egzemplarza, na który może czekać ktoś inny
+        for (auto& wpis : dostepne) {
+            stable_partition(wpis.second.begin(), wpis.second.end(),
+                             [&](size_t i) { return katalog[i].getOdlozonaDla() != login; });
+        }
+
+        vector<size_t> wybrane;
+        bool brakuje = false;
+        for (const auto& tytul : tytuly) {
+            auto& egzemplarze = dostepne[tytul];
+            if (egzemplarze.empty()) {
+                cout << "Nie znaleziono dostępnej książki o podanym tytule: " << tytul << "\n";
+                if (any_of(katalog.begin(), katalog.end(), [&](const Ksiazka& k) { return k.getTytul() == tytul; })) {
+                    cout << "Wszystkie egzemplarze są zajęte - możesz zarezerwować tę książkę (opcja 9).\n";
+                }
+                brakuje = true;
+                continue;
+            }
+            wybrane.push_back(egzemplarze.back());
+            egzemplarze.pop_back();
+        }
+        if (brakuje) {
+            if (tytuly.size() > 1) cout << "Nie wypożyczono żadnej książki.\n";
+            return false;
+        }
+
+        vector<string> zdarzenia;
+        Rezerwacje& rezerwacje = Rezerwacje::aktualne();
+        time_t teraz = czasTeraz();
+        for (size_t i : wybrane) {
+            Ksiazka& ksiazka = katalog[i];
+            if (!ksiazka.getOdlozonaDla().empty()) {
+                rezerwacje.usunOdlozenie(static_cast<int>(i) + 1);
+            }
+            if (rezerwacje.anuluj(ksiazka.getTytul(), login)) {
+                zdarzenia.push_back("ANULOWANIE;" + ksiazka.getTytul() + ";" + login);
+            }
+            ksiazka.wypozycz(login, teraz);
+            TerminyWypozyczen::aktualne().wypozycz(static_cast<int>(i) + 1, teraz);
+            dodajWypozyczenie(Wypozyczenie(static_cast<int>(i) + 1, "", teraz));
+            zdarzenia.push_back("WYPOZYCZENIE;" + ksiazka.getNumer() + ";" + login);
+            cout << "Wypożyczono książkę: " << ksiazka.getTytul() << "\n";
+        }
+        DziennikZmian::aktualny().publikuj(zdarzenia);
+        return true;
+    }
+
+    // Pozwala zwrócić wypożyczoną książkę i nalicza ewentualne kary
+    void zwrocKsiazke(vector<Ksiazka>& katalog) {
+
+        cout << "\n=== ZWRÓĆ KSIĄŻKĘ ===\n";
+        if (!wyswietlNiezwrocone(katalog)) return;
+        cout << "Podaj tytuł książki do zwrotu: ";
+        string tytul;
+
+        getline(cin >> ws, tytul);
+        if (tytul.empty()) {
+            cout << "Tytuł nie może być pusty!\n";
+            return;
+        }
+        zwrocKsiazki(katalog, {tytul});
+    }
+
+    // Pozwala zwrócić kilka książek naraz (wszystkie albo żadnej)
+    void zwrocKilkaKsiazek(vector<Ksiazka>& katalog) {
+        cout << "\n=== ZWRÓĆ KILKA KSIĄŻEK ===\n";
+        if (!wyswietlNiezwrocone(katalog)) return;
+        vector<string> tytuly = wczytajTytuly("zwrotu");
+        if (tytuly.empty()) {
+            cout << "Nie podano żadnego tytułu.\n";
+            return;
+        }
+        zwrocKsiazki(katalog, tytuly);
+    }
+
+    // Zwraca wszystkie podane tytuły albo - jeśli któregoś nie ma wśród wypożyczeń - żaden.
+    // Kary są naliczane dla wszystkich zwrotów z jedną datą, a zmiany trafiają
+    // do dziennika jednym zapisem.
+    bool zwrocKsiazki(vector<Ksiazka>& katalog, const vector<string>& tytuly) {
+        // Szukamy tylko wśród niezwróconych wypożyczeń, nie w całej historii
+        vector<size_t> doZwrotu;
+        vector<bool> wybrane(aktywne.size(), false);
+        bool brakuje = false;
+        for (const auto& tytul : tytuly) {
+            bool znaleziono = false;
+            for (size_t a = 0; a < aktywne.size(); ++a) {
+                if (!wybrane[a] && tytulKsiazki(katalog, wypozyczenia[aktywne[a]].getIdKsiazki()) == tytul) {
+                    wybrane[a] = true;
+                    doZwrotu.push_back(aktywne[a]);
+                    znaleziono = true;
+                    break;
+                }
+            }
+            if (!znaleziono) {
+                cout << "Nie znaleziono wypożyczonej książki o podanym tytule: " << tytul << "\n";
+                brakuje = true;
+            }
+        }
+        if (brakuje) {
+            if (tytuly.size() > 1) cout << "Nie zwrócono żadnej książki.\n";
+            return false;
+        }
+
+        const PolitykaKar& polityka = PolitykaKar::aktualna();
+        time_t teraz = czasTeraz();
+        vector<string> zdarzenia;
+        zmieniony = true;
+        for (size_t i : doZwrotu) {
+            Wypozyczenie& wyp = wypozyczenia[i];
+            int dniOdWypozyczenia = dniSpoznienia(wyp.getCzasWypozyczenia(), teraz, 0);
+            for (size_t p = 0; p < polityka.getProgi().size(); ++p) {
+                double kara = polityka.obliczKare(p, dniOdWypozyczenia);
+                if (kara <= 0) continue;
+                const string& powod = polityka.getProgi()[p].powod;
+                wyp.dodajKare(Kara(kara, powod));
+                saldoKar += kara;
+                zdarzenia.push_back("KARA;" + login + ";" + to_string(kara) + ";" + powod);
+                if (p == 0) {
+                    cout << "Naliczono karę za przetrzymanie: " << kara << " zł\n";
+                } else {
+                    cout << "Naliczono dodatkową karę " << kara << " zł (" << powod << ")!\n";
+                }
+            }
+            wyp.oznaczJakoZwrocona();
+            // Wypożyczenie wskazuje dokładnie ten egzemplarz, który czytelnik ma
+            int id = wyp.getIdKsiazki();
+            if (id > 0 && static_cast<size_t>(id) <= katalog.size() && katalog[id - 1].isWypozyczona()) {
+                katalog[id - 1].zwroc();
+                TerminyWypozyczen::aktualne().zwroc(id);
+                zdarzenia.push_back("ZWROT;" + katalog[id - 1].getNumer() + ";" + login);
+                // Jeśli ktoś czeka na ten tytuł, egzemplarz od razu jest dla niego odkładany
+                string nastepny = Rezerwacje::aktualne().przekaz(katalog, id, teraz);
+                if (!nastepny.empty()) {
+                    zdarzenia.push_back("ODLOZENIE;" + katalog[id - 1].getNumer() + ";" + nastepny);
+                }
+            }
+            cout << "Książka została zwrócona: " << tytulKsiazki(katalog, id) << "\n";
+        }
+        aktywne.erase(remove_if(aktywne.begin(), aktywne.end(),
+                                [this](size_t i) { return wypozyczenia[i].isZwrocona(); }),
+                      aktywne.end());
+        DziennikZmian::aktualny().publikuj(zdarzenia);
+        return true;
+    }
+
+    // Wyświetla książki dostępne do wypożyczenia; zwraca false, jeśli nie ma żadnej
+    bool wyswietlDostepne(const vector<Ksiazka>& katalog) const {
         bool cosDostepne = false;
         for (const auto& ksiazka : katalog) {
-            if (!ksiazka.isWypozyczona()) {
+            if (ksiazka.isDostepnaDla(login)) {
                 cout << "- " << ksiazka.getTytul() << " (Autor: " << ksiazka.getAutor() << ")\n";
                 cosDostepne = true;
             }
         }
         if (!cosDostepne) {
             cout << "Brak dostępnych książek do wypożyczenia.\n";
+        }
+        return cosDostepne;
+    }
+
+    // Wyświetla niezwrócone książki czytelnika; zwraca false, jeśli nie ma żadnej
+    bool wyswietlNiezwrocone(const vector<Ksiazka>& katalog) const {
+        if (aktywne.empty()) {
+            cout << "Nie masz wypożyczonych książek.\n";
+            return false;
+        }
+        for (size_t i : aktywne) {
+            const auto& wyp = wypozyczenia[i];
+            cout << "- " << tytulKsiazki(katalog, wyp.getIdKsiazki()) << " (wypożyczona: " << wyp.getDataWypozyczenia() << ")\n";
+        }
+        return true;
+    }
+
+    // Wyświetla tylko aktualne (niezwrócone) wypożyczenia czytelnika
+    void wyswietlAktualneWypozyczenia(const vector<Ksiazka>& katalog) const {
+        if (aktywne.empty()) {
+            cout << "Nie masz wypożyczonych książek.\n";
             return;
         }
-        cout << "Podaj tytuł książki do wypożyczenia: ";
+        cout << "\n=== AKTUALNE WYPOŻYCZENIA ===\n";
+        time_t teraz = czasTeraz();
+        for (size_t i : aktywne) {
+            wypozyczenia[i].wyswietlInformacje(katalog, teraz);
+        }
+    }
+
+    // Pozwala zarezerwować tytuł, którego wszystkie egzemplarze są zajęte
+    void zarezerwujKsiazke(const vector<Ksiazka>& katalog) {
+        cout << "\n=== ZAREZERWUJ KSIĄŻKĘ ===\n";
+        cout << "Podaj tytuł książki do zarezerwowania: ";
         string tytul;
         getline(cin >> ws, tytul);
         if (tytul.empty()) {
             cout << "Tytuł nie może być pusty!\n";
             return;
         }
-
-        for (auto& ksiazka : katalog) {
-            if (ksiazka.getTytul() == tytul && !ksiazka.isWypozyczona()) {
-                ksiazka.wypozycz();
-                Wypozyczenie noweWyp(ksiazka.getTytul());
-                dodajWypozyczenie(noweWyp);
-                cout << "Wypożyczono książkę: " << ksiazka.getTytul() << "\n";
+        bool istnieje = false;
+        bool maEgzemplarz = false;
+        for (const auto& ksiazka : katalog) {
+            if (ksiazka.getTytul() != tytul) continue;
+            istnieje = true;
+            if (ksiazka.isWypozyczona() && ksiazka.getWypozyczajacy() == login) maEgzemplarz = true;
+            if (ksiazka.isDostepnaDla(login)) {
+                cout << "Ta książka jest dostępna - możesz ją od razu wypożyczyć.\n";
                 return;
             }
         }
-        cout << "Nie znaleziono dostępnej książki o podanym tytule.\n";
+        if (!istnieje) {
+            cout << "Nie ma w katalogu książki o podanym tytule.\n";
+            return;
+        }
+        if (maEgzemplarz) {
+            cout << "Masz już wypożyczony egzemplarz tej książki.\n";
+            return;
+        }
+        size_t miejsce = Rezerwacje::aktualne().dodaj(tytul, login);
+        if (miejsce == 0) {
+            cout << "Już masz rezerwację tej książki.\n";
+            return;
+        }
+        DziennikZmian::aktualny().publikuj("REZERWACJA;" + tytul + ";" + login);
+        cout << "Zarezerwowano książkę. Miejsce w kolejce: " << miejsce << "\n";
     }
 
-    // Pozwala zwrócić wypożyczoną książkę i nalicza ewentualne kary
-    void zwrocKsiazke(vector<Ksiazka>& katalog) {
-
-        cout << "\n=== ZWRÓĆ KSIĄŻKĘ ===\n";
-        bool cosWypozyczone = false;
-        for (const auto& wyp : wypozyczenia) {
-            if (!wyp.isZwrocona()) {
-                cout << "- " << wyp.getTytul() << " (wypożyczona: " << wyp.getDataWypozyczenia() << ")\n";
-                cosWypozyczone = true;
-            }
+    // Wyświetla rezerwacje czytelnika i pozwala anulować jedną z nich
+    void wyswietlRezerwacje(const vector<Ksiazka>& katalog) {
+        Rezerwacje& rezerwacje = Rezerwacje::aktualne();
+        cout << "\n=== MOJE REZERWACJE ===\n";
+        bool cokolwiek = false;
+        for (int id : rezerwacje.getOdlozone()) {
+            const Ksiazka& ksiazka = katalog[id - 1];
+            if (ksiazka.getOdlozonaDla() != login) continue;
+            cout << "- " << ksiazka.getTytul() << ": czeka na odbiór do "
+                 << formatujDateGodzine(Rezerwacje::terminOdbioru(ksiazka.getCzasOdlozenia())) << "\n";
+            cokolwiek = true;
         }
-        if (!cosWypozyczone) {
-            cout << "Nie masz wypożyczonych książek.\n";
+        auto kolejki = rezerwacje.rezerwacjeCzytelnika(login);
+        for (const auto& wpis : kolejki) {
+            cout << "- " << wpis.first << ": miejsce w kolejce " << wpis.second << "\n";
+            cokolwiek = true;
+        }
+        if (!cokolwiek) {
+            cout << "Nie masz żadnych rezerwacji.\n";
             return;
         }
-        cout << "Podaj tytuł książki do zwrotu: ";
+        if (kolejki.empty()) return;
+        cout << "Podaj tytuł rezerwacji do anulowania (pusty wiersz - powrót): ";
         string tytul;
-
-        getline(cin >> ws, tytul);
-        if (tytul.empty()) {
-            cout << "Tytuł nie może być pusty!\n";
-            return;
+        if (!getline(cin, tytul) || tytul.empty()) return;
+        if (rezerwacje.anuluj(tytul, login)) {
+            DziennikZmian::aktualny().publikuj("ANULOWANIE;" + tytul + ";" + login);
+            cout << "Rezerwacja została anulowana.\n";
+        } else {
+            cout << "Nie masz rezerwacji o podanym tytule.\n";
         }
-        for (auto& wyp : wypozyczenia) {
+    }
 
-            if (!wyp.isZwrocona() && wyp.getTytul() == tytul) {
-                int dniSpoznienia = wyp.obliczDniSpoznienia(14);
-                if (dniSpoznienia > 0) {
-                    double kara = wyp.obliczKareZaPrzetrzymanie();
-                    Kara nowaKara(kara, "Przetrzymanie powyżej 14 dni");
-                    wyp.dodajKare(nowaKara);
-                    saldoKar += kara;
-                    cout << "Naliczono karę za przetrzymanie: " << kara << " zł\n";
-                }
-                int dniOdWypozyczenia = (int)((time(0) - wyp.getCzasWypozyczenia()) / (60 * 60 * 24));
-                if (dniOdWypozyczenia > 30) {
-                    int dniPonadMiesiac = dniOdWypozyczenia - 30;
-                    double karaMiesiac = dniPonadMiesiac * 1.0;
-                    Kara nowaKaraMiesiac(karaMiesiac, "Przetrzymanie powyżej miesiąca");
-                    wyp.dodajKare(nowaKaraMiesiac);
-                    saldoKar += karaMiesiac;
-                    cout << "Naliczono dodatkową karę " << karaMiesiac << " zł za przetrzymanie powyżej miesiąca!\n";
-                }
-                wyp.oznaczJakoZwrocona();
-                for (auto& ksiazka : katalog) {
-                    if (ksiazka.getTytul() == tytul) {
-                        ksiazka.zwroc();
-                        break;
-                    }
-                }
-                cout << "Książka została zwrócona.\n";
-                return;
-            }
+    // Wczytuje listę tytułów, po jednym w wierszu, aż do pustego wiersza
+    static vector<string> wczytajTytuly(const string& cel) {
+        cout << "Podaj tytuły książek do " << cel << " (każdy w osobnym wierszu, pusty wiersz kończy):\n";
+        vector<string> tytuly;
+        string tytul;
+        while (getline(cin, tytul) && !tytul.empty()) {
+            tytuly.push_back(tytul);
         }
-        cout << "Nie znaleziono wypożyczonej książki o podanym tytule.\n";
+        return tytuly;
     }
 
     // Menu czytelnika - pozwala wybrać operacje do wykonania
@@ -403,10 +1939,15 @@ public:
                  << "3. Zapłać karę\n"
                  << "4. Wypożycz książkę\n"
                  << "5. Zwróć książkę\n"
+                 << "6. Wypożycz kilka książek\n"
+                 << "7. Zwróć kilka książek\n"
+                 << "8. Moje aktualne wypożyczenia\n"
+                 << "9. Zarezerwuj książkę\n"
+                 << "10. Moje rezerwacje\n"
                  << "0. Wyloguj\n"
                  << "Wybor: ";
             string wyborStr;
-            getline(cin, wyborStr);
+            if (!getline(cin, wyborStr)) break;
             try {
                 wybor = stoi(wyborStr);
             } catch (...) {
@@ -414,8 +1955,8 @@ public:
                 continue;
             }
             switch (wybor) {
-                case 1: wyswietlWypozyczenia(); break;
-                case 2: wyswietlKary(); break;
+                case 1: wyswietlWypozyczenia(katalog); break;
+                case 2: wyswietlKary(katalog); break;
                 case 3: {
                     if (saldoKar > 0) {
                         cout << "Podaj kwotę do zapłaty (max " << saldoKar << " zł): ";
@@ -440,6 +1981,15 @@ public:
                 case 5:
                     zwrocKsiazke(katalog);
                     break;
+                case 6:
+                    wypozyczKilkaKsiazek(katalog);
+                    break;
+                case 7:
+                    zwrocKilkaKsiazek(katalog);
+                    break;
+                case 8: wyswietlAktualneWypozyczenia(katalog); break;
+                case 9: zarezerwujKsiazke(katalog); break;
+                case 10: wyswietlRezerwacje(katalog); break;
                 case 0: cout << "Wylogowano.\n"; break;
                 default: cout << "Nieprawidłowy wybór.\n";
             }
@@ -448,6 +1998,47 @@ public:
     void wyswietlMenu(vector<Ksiazka>&, vector<shared_ptr<Uzytkownik>>&) override {}
 };
 
+list<Czytelnik*> Czytelnik::wczytani;
+size_t Czytelnik::limitWczytanych = 64;
+
+// ------------------------------
+// Funkcja policzPamiecDanych
+// Liczy pamięć zajmowaną przez katalog, użytkowników (z wypożyczeniami i karami),
+// kolejki rezerwacji i indeks terminów wypożyczeń. Indeks loginów systemu jest szacowany
+// z listy użytkowników - ma po jednym wpisie na użytkownika.
+// ------------------------------
+RaportPamieci policzPamiecDanych(const vector<Ksiazka>& katalog, const vector<shared_ptr<Uzytkownik>>& uzytkownicy) {
+    RaportPamieci raport;
+    raport.dodajWektor(katalog, RaportPamieci::KSIAZKA);
+    for (const auto& ksiazka : katalog) ksiazka.policzPamiec(raport);
+
+    raport.dodajWektor(uzytkownicy, RaportPamieci::NARZUT);
+    raport.dodaj(RaportPamieci::NARZUT, uzytkownicy.size(), uzytkownicy.size() * RaportPamieci::BLOK_KONTROLNY);
+    for (const auto& u : uzytkownicy) {
+        u->policzPamiec(raport);
+        // Wpis indeksu loginów: węzeł (z kopią loginu) i kubełek
+        raport.dodaj(RaportPamieci::NARZUT, 1,
+                     3 * sizeof(void*) + sizeof(pair<const string, size_t>) + sizeof(size_t));
+        raport.dodajNapis(u->getLogin());
+    }
+    Rezerwacje::aktualne().policzPamiec(raport);
+    TerminyWypozyczen::aktualne().policzPamiec(raport);
+    return raport;
+}
+
+// ------------------------------
+// Funkcja zmniejszPamiecDanych
+// Zwalnia niewykorzystaną pojemność wektorów i napisów (shrink_to_fit).
+// Następne dopisanie do zmniejszonego wektora wymusi jego realokację.
+// ------------------------------
+void zmniejszPamiecDanych(vector<Ksiazka>& katalog, vector<shared_ptr<Uzytkownik>>& uzytkownicy) {
+    katalog.shrink_to_fit();
+    for (auto& k : katalog) k.zmniejszPamiec();
+    uzytkownicy.shrink_to_fit();
+    for (auto& u : uzytkownicy) u->zmniejszPamiec();
+    Rezerwacje::aktualne().zmniejszPamiec();
+}
+
 // ------------------------------
 // Klasa Bibliotekarz
 // Dziedziczy po Uzytkownik. Reprezentuje bibliotekarza.
@@ -459,8 +2050,13 @@ public:
     Bibliotekarz(string login = "", string haslo = "")
         : Uzytkownik(login, haslo, "bibliotekarz") {}
 
+    void policzPamiec(RaportPamieci& raport) const override {
+        raport.dodaj(RaportPamieci::BIBLIOTEKARZ, 1, sizeof(Bibliotekarz));
+        Uzytkownik::policzPamiec(raport);
+    }
+
     // Wyświetla wszystkie książki w katalogu
-    void wyswietlKsiazki(const vector<Ksiazka>& katalog) const {
+    static void wyswietlKsiazki(const vector<Ksiazka>& katalog) {
         if (katalog.empty()) {
             cout << "Katalog jest pusty.\n";
             return;
@@ -506,11 +2102,13 @@ public:
 
         // Dodajemy książkę z automatycznie nadanym numerem
         katalog.emplace_back(tytul, autor, nowyNumer);
+        TerminyWypozyczen::aktualne().dodajKsiazke();
+        DziennikZmian::aktualny().publikuj("KSIAZKA;" + tytul + ";" + autor + ";" + nowyNumer);
         cout << "Książka została dodana do katalogu. Numer: " << nowyNumer << endl;
     }
 
     // Pozwala wyszukać książki po tytule, autorze lub numerze
-    void szukajKsiazki(const vector<Ksiazka>& katalog) const {
+    static void szukajKsiazki(const vector<Ksiazka>& katalog) {
         string fraza;
         cout << "Wpisz frazę do wyszukania (tytuł/autor/numer): ";
         getline(cin >> ws, fraza);
@@ -569,8 +2167,11 @@ public:
             cout << "Hasło nie może być puste!\n";
             return;
         }
-        auto nowyCzytelnik = make_shared<Czytelnik>(imie, nazwisko, email, telefon, login, haslo);
+        auto nowyCzytelnik = make_shared<Czytelnik>(imie, nazwisko, email, telefon, login);
+        nowyCzytelnik->ustawHaslo(haslo);
         uzytkownicy.push_back(nowyCzytelnik);
+        nowyCzytelnik->wczytajWypozyczenia(); // Na listę wczytanych (pilnuje limitu w pamięci)
+        DziennikZmian::aktualny().publikuj("CZYTELNIK;" + login);
         cout << "Czytelnik został zarejestrowany.\n";
     }
 
@@ -587,14 +2188,67 @@ public:
         }
     }
 
+    // Pokazuje, kto ma wypożyczone książki pasujące do frazy (tytuł/numer)
+    // Wypożyczającego i czas wypożyczenia zna sama książka - rekordy czytelników nie są wczytywane.
+    static void ktoMaKsiazke(const vector<Ksiazka>& katalog) {
+        string fraza;
+        cout << "Wpisz tytuł lub numer książki: ";
+        getline(cin >> ws, fraza);
+        if (fraza.empty()) {
+            cout << "Fraza nie może być pusta!\n";
+            return;
+        }
+        bool znaleziono = false;
+        for (const auto& ksiazka : katalog) {
+            if (!ksiazka.isWypozyczona()) continue;
+            if (ksiazka.getTytul() != fraza && ksiazka.getNumer() != fraza) continue;
+            znaleziono = true;
+            cout << ksiazka.getTytul() << " (nr " << ksiazka.getNumer() << "): ";
+            if (ksiazka.getWypozyczajacy().empty()) {
+                cout << "wypożyczona, brak danych o wypożyczającym\n";
+                continue;
+            }
+            cout << "wypożyczona przez " << ksiazka.getWypozyczajacy();
+            if (ksiazka.getCzasWypozyczenia() != 0) {
+                cout << " (od " << formatujDate(ksiazka.getCzasWypozyczenia()) << ")";
+            }
+            cout << "\n";
+        }
+        if (!znaleziono) {
+            cout << "Żadna książka o podanym tytule lub numerze nie jest wypożyczona.\n";
+        }
+    }
+
+    // Przegląd przetrzymanych książek w całej bibliotece - z indeksu terminów,
+    // bez wczytywania rekordów czytelników
+    static void przetrzymaneKsiazki(const vector<Ksiazka>& katalog) {
+        auto przetrzymane = TerminyWypozyczen::aktualne().przetrzymane(czasTeraz());
+        cout << "\n=== PRZETRZYMANE KSIĄŻKI ===\n";
+        if (przetrzymane.empty()) {
+            cout << "Brak przetrzymanych książek.\n";
+            return;
+        }
+        double suma = 0.0;
+        for (const auto& p : przetrzymane) {
+            const Ksiazka& ksiazka = katalog[p.idKsiazki - 1];
+            cout << "- " << ksiazka.getTytul() << " (nr " << ksiazka.getNumer() << "): "
+                 << (ksiazka.getWypozyczajacy().empty() ? "nieznany czytelnik" : ksiazka.getWypozyczajacy())
+                 << ", dni spóźnienia: " << p.dniSpoznienia
+                 << ", kara na dziś: " << fixed << setprecision(2) << p.kara << " zł\n";
+            suma += p.kara;
+        }
+        cout << "Razem: " << przetrzymane.size() << " książek, " << fixed << setprecision(2) << suma << " zł\n";
+    }
+
     // Pozwala zarządzać karami wybranego czytelnika
-    void zarzadzajKaramiCzytelnika(vector<shared_ptr<Uzytkownik>>& uzytkownicy) {
+    void zarzadzajKaramiCzytelnika(const vector<Ksiazka>& katalog, vector<shared_ptr<Uzytkownik>>& uzytkownicy) {
         string email;
         cout << "Podaj email czytelnika: ";
         getline(cin >> ws, email);
         for (auto& uzytkownik : uzytkownicy) {
             if (auto czytelnik = dynamic_cast<Czytelnik*>(uzytkownik.get())) {
                 if (czytelnik->getEmail() == email) {
+                    czytelnik->wczytajWypozyczenia();
                     cout << "\n=== ZARZĄDZANIE KARAMI ===\n"
                          << "Czytelnik: " << czytelnik->getImie() << " " << czytelnik->getNazwisko() << "\n"
                          << "Aktualne saldo kar: " << czytelnik->getSaldoKar() << " zł\n\n";
@@ -605,7 +2259,7 @@ public:
                              << "0. Powrót\n"
                              << "Wybor: ";
                         string wyborStr;
-                        getline(cin, wyborStr);
+                        if (!getline(cin, wyborStr)) break;
                         try {
                             wybor = stoi(wyborStr);
                         } catch (...) {
@@ -635,26 +2289,22 @@ public:
                                     cout << "Powód nie może być pusty!\n";
                                     break;
                                 }
-                                bool znaleziono = false;
-                                for (auto& wypozyczenie : czytelnik->getWypozyczenia()) {
-                                    if (!wypozyczenie.isZwrocona()) {
-                                        wypozyczenie.dodajKare(Kara(kwota, powod));
-                                        czytelnik->setSaldoKar(czytelnik->getSaldoKar() + kwota);
-                                        znaleziono = true;
-                                        break;
-                                    }
-                                }
-                                if (!znaleziono) {
-                                    Wypozyczenie noweWypozyczenie("Kara administracyjna");
+                                const auto& aktywne = czytelnik->getAktywneWypozyczenia();
+                                if (!aktywne.empty()) {
+                                    czytelnik->getWypozyczenia()[aktywne.front()].dodajKare(Kara(kwota, powod));
+                                    czytelnik->setSaldoKar(czytelnik->getSaldoKar() + kwota);
+                                } else {
+                                    Wypozyczenie noweWypozyczenie(0); // Kara administracyjna
                                     noweWypozyczenie.dodajKare(Kara(kwota, powod));
                                     czytelnik->dodajWypozyczenie(noweWypozyczenie);
                                     czytelnik->setSaldoKar(czytelnik->getSaldoKar() + kwota);
                                 }
+                                DziennikZmian::aktualny().publikuj("KARA;" + czytelnik->getLogin() + ";" + to_string(kwota) + ";" + powod);
                                 cout << "Dodano karę.\n";
                                 break;
                             }
                             case 2:
-                                czytelnik->wyswietlKary();
+                                czytelnik->wyswietlKary(katalog);
                                 break;
                             case 0:
                                 break;
@@ -669,6 +2319,21 @@ public:
         cout << "Nie znaleziono czytelnika o podanym emailu.\n";
     }
 
+    // Wyświetla raport pamięci zajmowanej przez dane biblioteki
+    static void wyswietlZuzyciePamieci(const vector<Ksiazka>& katalog, const vector<shared_ptr<Uzytkownik>>& uzytkownicy) {
+        cout << "\n=== ZUŻYCIE PAMIĘCI ===\n";
+        policzPamiecDanych(katalog, uzytkownicy).wypisz(cout);
+    }
+
+    // Zwalnia niewykorzystaną pojemność kontenerów i pokazuje, ile odzyskano
+    static void zmniejszZapasPamieci(vector<Ksiazka>& katalog, vector<shared_ptr<Uzytkownik>>& uzytkownicy) {
+        size_t przed = policzPamiecDanych(katalog, uzytkownicy).getSuma();
+        zmniejszPamiecDanych(katalog, uzytkownicy);
+        size_t po = policzPamiecDanych(katalog, uzytkownicy).getSuma();
+        cout << "Zmniejszono zapas pamięci: " << przed << " B -> " << po << " B (odzyskano "
+             << (przed > po ? przed - po : 0) << " B).\n";
+    }
+
     // Menu bibliotekarza - pozwala wybrać operacje do wykonania
     void wyswietlMenu(vector<Ksiazka>& katalog, vector<shared_ptr<Uzytkownik>>& uzytkownicy) override {
         int wybor = -1;
@@ -680,10 +2345,14 @@ public:
                  << "4. Zarejestruj czytelnika\n"
                  << "5. Lista czytelników\n"
                  << "6. Zarządzaj karami czytelnika\n"
+                 << "7. Kto ma książkę?\n"
+                 << "8. Zużycie pamięci\n"
+                 << "9. Zmniejsz zapas pamięci (shrink)\n"
+                 << "10. Przetrzymane książki\n"
                  << "0. Wyloguj\n"
                  << "Wybor: ";
             string wyborStr;
-            getline(cin, wyborStr);
+            if (!getline(cin, wyborStr)) break;
             try {
                 wybor = stoi(wyborStr);
             } catch (...) {
@@ -696,7 +2365,11 @@ public:
                 case 3: szukajKsiazki(katalog); break;
                 case 4: zarejestrujCzytelnika(uzytkownicy); break;
                 case 5: listaCzytelnikow(uzytkownicy); break;
-                case 6: zarzadzajKaramiCzytelnika(uzytkownicy); break;
+                case 6: zarzadzajKaramiCzytelnika(katalog, uzytkownicy); break;
+                case 7: ktoMaKsiazke(katalog); break;
+                case 8: wyswietlZuzyciePamieci(katalog, uzytkownicy); break;
+                case 9: zmniejszZapasPamieci(katalog, uzytkownicy); break;
+                case 10: przetrzymaneKsiazki(katalog); break;
                 case 0: cout << "Wylogowano.\n"; break;
                 default: cout << "Nieprawidłowy wybór.\n";
             }
@@ -709,18 +2382,57 @@ public:
 // Klasa SystemBiblioteczny
 // Główna klasa zarządzająca całą aplikacją biblioteczną.
 // Przechowuje katalog książek, użytkowników i obsługuje logowanie oraz zapis/odczyt danych.
+// Program obsługuje jedną sesję naraz (jeden wątek) - przeglądanie katalogu i zapis
+// danych przechodzą bezpośrednio po katalogu, bez kopii. Współbieżny odczyt
+// zapewnia osobny proces kiosku (patrz KioskKatalogu), który ma własną kopię.
 // ------------------------------
 class SystemBiblioteczny {
 private:
     vector<Ksiazka> katalog;                          // Katalog książek
     vector<shared_ptr<Uzytkownik>> uzytkownicy;       // Lista użytkowników
     shared_ptr<Uzytkownik> aktualnyUzytkownik;        // Aktualnie zalogowany użytkownik
+    unordered_map<string, size_t> indeksLoginow;      // Login -> pozycja w liście użytkowników
+    size_t zindeksowanych = 0;                        // Ilu użytkowników jest już w indeksie
+    unsigned long long numerZmiany = 0;               // Numer ostatniej zmiany zawartej w pliku danych
+    string plikDanych;                                // Nazwa plików danych bez rozszerzenia
+    size_t generowanych;                              // Ile dodatkowych książek i czytelników wygenerować
+    PulaWeryfikacji pulaWeryfikacji;                  // Wątki sprawdzające hasła przy logowaniu
 
 public:
     // Konstruktor - wczytuje dane z pliku lub tworzy przykładowe dane
-    SystemBiblioteczny() {
+    // (powiększone o 'generowanych' wygenerowanych książek i czytelników).
+    // Wypożyczenia czytelników są wczytywane dopiero przy pierwszym użyciu,
+    // a w pamięci trzymanych jest najwyżej limitWczytanych rekordów naraz
+    // (ustawienia.cfg) - pozostałe zostają na dysku (patrz MagazynRekordow).
+    // W trybie testowym kary.cfg jest pomijany - nagrania zawsze liczą kary
+    // według zasad domyślnych, niezależnie od konfiguracji na danym komputerze -
+    // a koszt haszowania haseł zostaje ten, który ustawił test.
+    SystemBiblioteczny(const string& plikDanych = "biblioteka", size_t generowanych = 0, bool trybTestowy = false)
+        : plikDanych(plikDanych), generowanych(generowanych) {
+        Ustawienia ustawienia;
+        ustawienia.wczytaj("ustawienia.cfg");
+        Czytelnik::limitWczytanych = ustawienia.limitWczytanych;
+        if (trybTestowy) {
+            PolitykaKar::aktualna() = PolitykaKar();
+        } else {
+            Uzytkownik::kosztHasla = ustawienia.kosztHasla;
+            PolitykaKar::aktualna().wczytaj("kary.cfg");
+        }
+        kontoZastepcze(); // Haszowane od razu, a nie przy pierwszym nieznanym loginie
+        bool pierwszeUruchomienie = !filesystem::exists(plikDanych + ".txt");
         wczytajDane();
-        naliczKaryZaPrzetrzymanie();
+        size_t odrzucone = DziennikZmian::aktualny().otworz(plikDanych + ".zmiany", numerZmiany);
+        if (odrzucone > 0) {
+            // Zapis publikuje dane bez odrzuconych zmian i czyści dziennik
+            cout << "Uwaga: odrzucono " << odrzucone << " zmian niezapisanych przed awarią.\n";
+            zapiszDane();
+        } else if (pierwszeUruchomienie) {
+            // Przykładowe dane nie trafiają do dziennika - bez pierwszego zapisu
+            // kiosk widziałby tylko książki dodane po uruchomieniu
+            zapiszDane();
+        }
+        naliczZalegleKary();
+        zwolnijWygasleOdlozenia();
     }
 
     // Destruktor - zapisuje dane do pliku przy zamknięciu programu
@@ -728,11 +2440,17 @@ public:
         zapiszDane();
     }
 
+    // Raport pamięci zajmowanej przez dane (do raportów testów obciążeniowych)
+    RaportPamieci raportPamieci() const { return policzPamiecDanych(katalog, uzytkownicy); }
+
     // Główna pętla programu - logowanie i obsługa menu użytkownika
     void uruchom() {
         while (true) {
             cout << "\n=== SYSTEM BIBLIOTECZNY ===\n";
-            if (!logowanie()) continue;
+            if (!logowanie()) {
+                if (!cin) break; // Koniec danych wejściowych
+                continue;
+            }
 
             if (aktualnyUzytkownik->getRola() == "bibliotekarz") {
                 dynamic_cast<Bibliotekarz*>(aktualnyUzytkownik.get())->wyswietlMenu(katalog, uzytkownicy);
@@ -742,7 +2460,7 @@ public:
 
             aktualnyUzytkownik = nullptr;
             cout << "Czy chcesz się zalogować ponownie? (t/n): ";
-            char odp;
+            char odp = 'n';
             cin >> odp;
             cin.ignore();
             if (tolower(odp) != 't') break;
@@ -751,89 +2469,154 @@ public:
     }
 
 private:
-    // Zapisuje wszystkie dane do pliku tekstowego
+    // Zapisuje wszystkie dane do pliku tekstowego.
+    // Plik jest najpierw zapisywany obok i podmieniany w całości, żeby kiosk
+    // czytający dane w tym samym czasie nie trafił na niepełny plik.
+    // Wiersz czytelnika kończy długość jego rekordu WI:/K:, więc przy wczytywaniu
+    // rekord można przeskoczyć i czytać go z pliku dopiero przy pierwszym użyciu.
     void zapiszDane() {
-        ofstream plik("biblioteka.txt");
+        // Hasła jawne ze starszych danych nigdy nie trafiają z powrotem do pliku -
+        // haszowanie jest kosztowne, więc wszystkie są haszowane naraz w puli
+        vector<future<bool>> haszowane;
+        for (const auto& u : uzytkownicy) {
+            if (!u->isHasloZahaszowane()) haszowane.push_back(pulaWeryfikacji.zlecHaszowanie(u));
+        }
+        for (auto& h : haszowane) h.get();
+
+        string sciezka = plikDanych + ".txt";
+        ofstream plik(sciezka + ".tmp", ios::binary);
+        // Numer ostatniej zmiany z dziennika zawartej w tym zapisie
+        plik << "SEQ;" << DziennikZmian::aktualny().getNumer() << "\n";
         // Katalog
         plik << "KSIAZKI\n";
-        for (const auto& k : katalog) {
-            plik << k.getTytul() << ";" << k.getAutor() << ";" << k.getNumer() << ";" << k.isWypozyczona() << "\n";
+        const TerminyWypozyczen& terminy = TerminyWypozyczen::aktualne();
+        for (size_t i = 0; i < katalog.size(); ++i) {
+            const Ksiazka& k = katalog[i];
+            plik << k.getTytul() << ";" << k.getAutor() << ";" << k.getNumer() << ";" << k.isWypozyczona()
+                 << ";" << k.getWypozyczajacy() << ";" << k.getOdlozonaDla() << ";" << k.getCzasOdlozenia()
+                 << ";" << k.getCzasWypozyczenia() << ";" << terminy.isNaliczona(static_cast<int>(i) + 1) << "\n";
         }
         // Użytkownicy
         plik << "CZYTELNICY\n";
+        vector<pair<Czytelnik*, MagazynRekordow::Polozenie>> rekordy; // Położenie rekordów w nowym pliku
         for (const auto& u : uzytkownicy) {
             if (u->getRola() == "czytelnik") {
                 auto c = dynamic_cast<Czytelnik*>(u.get());
+                // Wypożyczenia (niewczytane rekordy są przepisywane z dysku bez parsowania)
+                string rekord = c->serializujWypozyczenia();
                 plik << c->getImie() << ";" << c->getNazwisko() << ";" << c->getEmail() << ";" << c->getTelefon()
-                     << ";" << c->getLogin() << ";" << c->getSaldoKar() << ";" << c->getHaslo() << "\n";
-                // Wypożyczenia
-                for (const auto& w : c->getWypozyczenia()) {
-                    plik << "W:" << w.getTytul() << ";" << w.getDataWypozyczenia() << ";" << w.isZwrocona() << ";" << w.getCzasWypozyczenia() << "\n";
-                    for (const auto& kara : w.getKary()) {
-                        plik << "K:" << kara.getKwota() << ";" << kara.getPowod() << ";" << kara.getData() << ";" << kara.isZaplacona() << "\n";
-                    }
-                }
+                     << ";" << c->getLogin() << ";" << c->getSaldoKar() << ";" << c->getHaslo()
+                     << ";" << rekord.size() << "\n";
+                rekordy.push_back({c, {static_cast<streamoff>(plik.tellp()), rekord.size(), false}});
+                plik << rekord;
             }
             if (u->getRola() == "bibliotekarz") {
                 plik << "BIB;" << u->getLogin() << ";" << u->getHaslo() << "\n";
             }
         }
+        // Kolejki rezerwacji
+        plik << "REZERWACJE\n";
+        Rezerwacje::aktualne().zapisz(plik);
         plik.close();
+
+        // Podmiana jednym krokiem - w razie awarii zostaje stary albo nowy plik, nigdy żaden.
+        // Plik danych jest na ten czas zamykany (w Windows nie da się podmienić otwartego pliku).
+        MagazynRekordow& magazyn = MagazynRekordow::aktualny();
+        magazyn.zamknijDane();
+        error_code blad;
+        filesystem::rename(sciezka + ".tmp", sciezka, blad);
+        if (blad) {
+            cout << "Nie udało się zapisać pliku " << sciezka << ": " << blad.message() << "\n";
+            magazyn.otworzDane();
+            return;
+        }
+        // Wszystkie rekordy leżą teraz w nowym pliku - plik zrzutu zaczyna się od nowa
+        magazyn.otworz(sciezka, plikDanych + ".rekordy");
+        for (const auto& r : rekordy) r.first->ustawPolozenieRekordu(r.second);
+        DziennikZmian::aktualny().wyczysc();
     }
 
     // Wczytuje dane z pliku tekstowego lub tworzy przykładowe dane
     void wczytajDane() {
-        ifstream plik("biblioteka.txt");
+        Rezerwacje::aktualne().wyczysc();
+        MagazynRekordow::aktualny().otworz(plikDanych + ".txt", plikDanych + ".rekordy");
+        ifstream plik(plikDanych + ".txt", ios::binary);
         if (!plik) {
             inicjalizujDane();
+            TerminyWypozyczen::aktualne().zbuduj(katalog);
+            // Nowi czytelnicy też podlegają limitowi - nadmiarowi trafiają do pliku zrzutu
+            for (const auto& uzytkownik : uzytkownicy) {
+                if (auto czytelnik = dynamic_cast<Czytelnik*>(uzytkownik.get())) czytelnik->wczytajWypozyczenia();
+            }
             return;
         }
         katalog.clear();
         uzytkownicy.clear();
-        string linia, sekcja;
+        string linia, sekcja, rekord;
         shared_ptr<Czytelnik> ostatniCzytelnik = nullptr;
-        Wypozyczenie* ostatnieWyp = nullptr;
+        unordered_map<string, vector<int>> idPoTytule; // Do migracji starych wierszy W:
+        vector<bool> przypisane;                       // Egzemplarze już przypisane wypożyczeniom
+        size_t bezCzasu = 0;                           // Wypożyczone egzemplarze bez czasu wypożyczenia (starsze pliki)
+        vector<int> zNaliczonaKara;                    // Egzemplarze z naliczoną karą automatyczną
+        // Starsze pliki nie mają długości rekordu w wierszu czytelnika - wiersze WI:/K:
+        // są zbierane i odkładane do pliku zrzutu (parsuje je Czytelnik::wczytajWypozyczenia)
+        auto zamknijRekord = [&]() {
+            if (ostatniCzytelnik) ostatniCzytelnik->ustawRekord(MagazynRekordow::aktualny().zapisz(rekord));
+            rekord.clear();
+        };
         while (getline(plik, linia)) {
-            if (linia == "KSIAZKI" || linia == "CZYTELNICY") {
+            if (!linia.empty() && linia.back() == '\r') linia.pop_back();
+            if (linia == "KSIAZKI" || linia == "CZYTELNICY" || linia == "REZERWACJE") {
+                zamknijRekord();
+                ostatniCzytelnik = nullptr;
                 sekcja = linia;
                 continue;
             }
+            if (sekcja.empty() && linia.rfind("SEQ;", 0) == 0) {
+                try { numerZmiany = stoull(linia.substr(4)); } catch (...) { numerZmiany = 0; }
+                continue;
+            }
             if (sekcja == "KSIAZKI") {
-                stringstream ss(linia);
-                string tytul, autor, numer, wyp;
-                getline(ss, tytul, ';');
-                getline(ss, autor, ';');
-                getline(ss, numer, ';');
-                getline(ss, wyp, ';');
-                katalog.emplace_back(tytul, autor, numer, wyp == "1");
+                katalog.push_back(parsujKsiazke(linia));
+                if (katalog.back().isWypozyczona() && katalog.back().getCzasWypozyczenia() == 0) ++bezCzasu;
+                if (linia.size() > 2 && linia.compare(linia.size() - 2, 2, ";1") == 0 &&
+                    count(linia.begin(), linia.end(), ';') == 8) {
+                    zNaliczonaKara.push_back(static_cast<int>(katalog.size()));
+                }
+                if (!katalog.back().getOdlozonaDla().empty()) {
+                    Rezerwacje::aktualne().dodajOdlozenie(static_cast<int>(katalog.size()));
+                }
+            } else if (sekcja == "REZERWACJE") {
+                Rezerwacje::aktualne().wczytajWiersz(linia);
             } else if (sekcja == "CZYTELNICY") {
-                if (linia.rfind("BIB;", 0) == 0) {
+                if (linia.rfind("W:", 0) == 0) {
+                    if (idPoTytule.empty()) {
+                        for (size_t i = 0; i < katalog.size(); ++i) {
+                            idPoTytule[katalog[i].getTytul()].push_back(static_cast<int>(i) + 1);
+                        }
+                        przypisane.assign(katalog.size(), false);
+                    }
+                    if (ostatniCzytelnik) {
+                        string wiersz = migrujWypozyczenie(linia, ostatniCzytelnik->getLogin(), idPoTytule, przypisane);
+                        if (bezCzasu > 0 && uzupelnijCzasWypozyczenia(wiersz)) --bezCzasu;
+                        rekord += wiersz + "\n";
+                    }
+                } else if (linia.rfind("WI:", 0) == 0 || linia.rfind("K:", 0) == 0) {
+                    if (!ostatniCzytelnik) continue;
+                    if (bezCzasu > 0 && linia[0] == 'W' && uzupelnijCzasWypozyczenia(linia)) --bezCzasu;
+                    rekord += linia + "\n";
+                } else if (linia.rfind("BIB;", 0) == 0) {
+                    zamknijRekord();
+                    ostatniCzytelnik = nullptr;
                     stringstream ss(linia.substr(4));
                     string login, haslo;
                     getline(ss, login, ';');
                     getline(ss, haslo, ';');
                     uzytkownicy.push_back(make_shared<Bibliotekarz>(login, haslo));
-                } else if (linia.rfind("W:", 0) == 0) {
-                    stringstream ss(linia.substr(2));
-                    string tytul, data, zwrot, czas;
-                    getline(ss, tytul, ';');
-                    getline(ss, data, ';');
-                    getline(ss, zwrot, ';');
-                    getline(ss, czas, ';');
-                    Wypozyczenie w(tytul, data, stol(czas), zwrot == "1");
-                    ostatniCzytelnik->dodajWypozyczenie(w);
-                    ostatnieWyp = &ostatniCzytelnik->getWypozyczenia().back();
-                } else if (linia.rfind("K:", 0) == 0 && ostatnieWyp) {
-                    stringstream ss(linia.substr(2));
-                    string kwota, powod, data, zapl;
-                    getline(ss, kwota, ';');
-                    getline(ss, powod, ';');
-                    getline(ss, data, ';');
-                    getline(ss, zapl, ';');
-                    ostatnieWyp->dodajKare(Kara(stod(kwota), powod, data, zapl == "1"));
                 } else {
+                    zamknijRekord();
                     stringstream ss(linia);
-                    string imie, nazwisko, email, telefon, login, saldo, haslo;
+                    string imie, nazwisko, email, telefon, login, saldo, haslo, dlugosc;
                     getline(ss, imie, ';');
                     getline(ss, nazwisko, ';');
                     getline(ss, email, ';');
@@ -841,54 +2624,82 @@ private:
                     getline(ss, login, ';');
                     getline(ss, saldo, ';');
                     getline(ss, haslo, ';');
-                    ostatniCzytelnik = make_shared<Czytelnik>(imie, nazwisko, email, telefon, login, haslo, stod(saldo));
+                    getline(ss, dlugosc, ';');
+                    ostatniCzytelnik = make_shared<Czytelnik>(imie, nazwisko, email, telefon, login, haslo, naKwote(saldo));
                     uzytkownicy.push_back(ostatniCzytelnik);
-                    ostatnieWyp = nullptr;
+                    // Znana długość rekordu: zostaje w pliku, zapamiętujemy tylko jego położenie
+                    if (!dlugosc.empty() && dlugosc.find_first_not_of("0123456789") == string::npos) {
+                        MagazynRekordow::Polozenie polozenie{static_cast<streamoff>(plik.tellg()),
+                                                             static_cast<size_t>(stoull(dlugosc)), false};
+                        ostatniCzytelnik->ustawRekord(polozenie);
+                        plik.seekg(polozenie.pozycja + static_cast<streamoff>(polozenie.dlugosc));
+                        ostatniCzytelnik = nullptr;
+                    }
                 }
             }
         }
+        zamknijRekord();
         plik.close();
+
+        TerminyWypozyczen& terminy = TerminyWypozyczen::aktualne();
+        terminy.zbuduj(katalog);
+        for (int id : zNaliczonaKara) terminy.ustawNaliczona(id, true);
     }
 
-    // Automatycznie nalicza kary za przetrzymanie książek po wczytaniu danych
-    void naliczKaryZaPrzetrzymanie() {
-        for (const auto& u : uzytkownicy) {
-            if (u->getRola() == "czytelnik") {
-                auto c = dynamic_cast<Czytelnik*>(u.get());
-                for (auto& wyp : c->getWypozyczenia()) {
-                    if (!wyp.isZwrocona()) {
-                        int dniSpoznienia = wyp.obliczDniSpoznienia(14);
-                        if (dniSpoznienia > 0) {
-                            double kara = wyp.obliczKareZaPrzetrzymanie();
-                            // Sprawdź, czy kara już nie została naliczona
-                            bool juzNaliczona = false;
-                            for (const auto& k : wyp.getKary()) {
-                                if (k.getPowod() == "Przetrzymanie powyżej 14 dni" && !k.isZaplacona()) {
-                                    juzNaliczona = true;
-                                    break;
-                                }
-                            }
-                            if (!juzNaliczona) {
-                                wyp.dodajKare(Kara(kara, "Przetrzymanie powyżej 14 dni"));
-                                c->setSaldoKar(c->getSaldoKar() + kara);
-                            }
-                        }
+    // Zamienia wiersz wypożyczenia ze starszego formatu ("W:tytul;...") na "WI:id;...".
+    // Niezwrócone wypożyczenie dostaje egzemplarz wypożyczony przez tego czytelnika
+    // (starsze pliki nie znają wypożyczającego - wpisujemy go do książki),
+    // a zwrócone - pierwszy egzemplarz o tym tytule. Nieznany tytuł dostaje ID 0.
+    string migrujWypozyczenie(const string& linia, const string& login,
+                              const unordered_map<string, vector<int>>& idPoTytule,
+                              vector<bool>& przypisane) {
+        stringstream ss(linia.substr(2));
+        string tytul, reszta, zwrot;
+        getline(ss, tytul, ';');
+        getline(ss, reszta);
+        stringstream pola(reszta);
+        getline(pola, zwrot, ';'); // data
+        getline(pola, zwrot, ';');
+
+        int id = 0;
+        auto it = idPoTytule.find(tytul);
+        if (it != idPoTytule.end()) {
+            id = it->second.front();
+            if (zwrot != "1") {
+                for (int kandydat : it->second) {
+                    Ksiazka& k = katalog[kandydat - 1];
+                    if (!przypisane[kandydat - 1] && k.isWypozyczona() &&
+                        (k.getWypozyczajacy() == login || k.getWypozyczajacy().empty())) {
+                        id = kandydat;
+                        przypisane[kandydat - 1] = true;
+                        if (k.getWypozyczajacy().empty()) k.wypozycz(login, k.getCzasWypozyczenia());
+                        break;
                     }
                 }
             }
         }
+        return "WI:" + to_string(id) + ";" + reszta;
     }
 
-    // Pomocnicza funkcja do konwersji string -> time_t
-    static time_t stol(const string& s) {
-        try { return static_cast<time_t>(stoll(s)); } catch (...) { return time(0); }
-    }
-    // Pomocnicza funkcja do konwersji string -> double
-    static double stod(const string& s) {
-        try { return std::stod(s); } catch (...) { return 0.0; }
+    // Starsze pliki nie mają czasu wypożyczenia w wierszu książki - przepisujemy go
+    // z niezwróconego wypożyczenia "WI:id;data;zwrot;czas". Zwraca true, jeśli uzupełniono.
+    bool uzupelnijCzasWypozyczenia(const string& wiersz) {
+        stringstream ss(wiersz.substr(3));
+        string id, data, zwrot, czas;
+        getline(ss, id, ';');
+        getline(ss, data, ';');
+        getline(ss, zwrot, ';');
+        getline(ss, czas, ';');
+        if (zwrot == "1") return false;
+        int idKsiazki = 0;
+        try { idKsiazki = stoi(id); } catch (...) { return false; }
+        if (idKsiazki <= 0 || static_cast<size_t>(idKsiazki) > katalog.size()) return false;
+        Ksiazka& ksiazka = katalog[idKsiazki - 1];
+        if (!ksiazka.isWypozyczona() || ksiazka.getCzasWypozyczenia() != 0) return false;
+        ksiazka.wypozycz(ksiazka.getWypozyczajacy(), naCzas(czas));
+        return true;
     }
 
-
     // Tworzy przykładowe dane (użytkownicy i książki) jeśli nie ma pliku
     void inicjalizujDane() {
         // Dodaj przykładowych bibliotekarzy
@@ -911,6 +2722,14 @@ private:
         katalog.emplace_back("Duma i uprzedzenie", "Jane Austen", "8901234567");
         katalog.emplace_back("Mistrz i Małgorzata", "Michaił Bułhakow", "9012345678");
         katalog.emplace_back("1984", "George Orwell", "0123456789");
+
+        // Dane wygenerowane na potrzeby testów obciążeniowych (zawsze takie same)
+        for (size_t i = 1; i <= generowanych; ++i) {
+            string nr = to_string(i);
+            katalog.emplace_back("Książka testowa " + nr, "Autor testowy " + to_string(i % 100), "T" + nr);
+            uzytkownicy.push_back(make_shared<Czytelnik>("Czytelnik", "Testowy " + nr, "czytelnik" + nr + "@bib.pl",
+                                                         "500000000", "czytelnik" + nr + "@bib.pl", "haslo" + nr));
+        }
     }
 
 
@@ -922,22 +2741,668 @@ private:
         cout << "Hasło: ";
         getline(cin, haslo);
 
-        for (const auto& u : uzytkownicy) {
-            if (u->getLogin() == login && u->sprawdzHaslo(haslo)) {
-                aktualnyUzytkownik = u;
-                cout << "Zalogowano jako: " << u->getLogin() << " (" << u->getRola() << ")\n";
-                return true;
+        zwolnijWygasleOdlozenia();
+        zaktualizujIndeksLoginow();
+        auto it = indeksLoginow.find(login);
+        bool istnieje = it != indeksLoginow.end();
+        // Nieznany login też przechodzi przez haszowanie (z kontem zastępczym),
+        // żeby po czasie odpowiedzi nie dało się poznać, które loginy istnieją
+        const auto& u = istnieje ? uzytkownicy[it->second] : kontoZastepcze();
+        if (pulaWeryfikacji.zlec(u, haslo).get() && istnieje) {
+            aktualnyUzytkownik = u;
+            // Wypożyczenia czytelnika są wczytywane dopiero po zalogowaniu
+            if (auto c = dynamic_cast<Czytelnik*>(u.get())) {
+                c->wczytajWypozyczenia();
             }
+            cout << "Zalogowano jako: " << u->getLogin() << " (" << u->getRola() << ")\n";
+            return true;
         }
         cout << "Błędne dane logowania.\n";
         return false;
     }
+
+    // Konto z hasłem zahaszowanym przy bieżącym koszcie, sprawdzane zamiast nieznanego loginu.
+    // Tworzone ponownie po zmianie kosztu, żeby sprawdzenie trwało tyle co dla prawdziwego konta.
+    static const shared_ptr<Uzytkownik>& kontoZastepcze() {
+        static shared_ptr<Uzytkownik> konto;
+        static int koszt = -1;
+        if (koszt != Uzytkownik::kosztHasla) {
+            konto = make_shared<Uzytkownik>();
+            konto->ustawHaslo(to_string(random_device{}()));
+            koszt = Uzytkownik::kosztHasla;
+        }
+        return konto;
+    }
+
+    // Nalicza kary za przetrzymanie także czytelnikom, których rekordy nie są wczytane.
+    // Przegląd indeksu terminów wskazuje przetrzymane wypożyczenia bez naliczonej kary
+    // i tylko rekordy ich wypożyczających są wczytywane (wczytanie nalicza karę).
+    void naliczZalegleKary() {
+        zaktualizujIndeksLoginow();
+        TerminyWypozyczen& terminy = TerminyWypozyczen::aktualne();
+        for (const auto& p : terminy.przetrzymane(czasTeraz())) {
+            if (p.kara <= 0 || terminy.isNaliczona(p.idKsiazki)) continue;
+            auto it = indeksLoginow.find(katalog[p.idKsiazki - 1].getWypozyczajacy());
+            if (it == indeksLoginow.end()) continue;
+            if (auto c = dynamic_cast<Czytelnik*>(uzytkownicy[it->second].get())) c->wczytajWypozyczenia();
+        }
+    }
+
+    // Przekazuje dalej egzemplarze odłożone dla rezerwujących, którzy po nie nie przyszli
+    void zwolnijWygasleOdlozenia() {
+        DziennikZmian::aktualny().publikuj(Rezerwacje::aktualne().zwolnijWygasle(katalog, czasTeraz()));
+    }
+
+    // Dopisuje do indeksu loginów użytkowników dodanych od ostatniej aktualizacji
+    // (lista użytkowników jest tylko rozszerzana, np. przy rejestracji czytelnika)
+    void zaktualizujIndeksLoginow() {
+        for (; zindeksowanych < uzytkownicy.size(); ++zindeksowanych) {
+            indeksLoginow.emplace(uzytkownicy[zindeksowanych]->getLogin(), zindeksowanych);
+        }
+    }
+};
+// ------------------------------
+// Klasa KioskKatalogu
+// Proces tylko do odczytu (np. kiosk dla czytelników) obsługujący przeglądanie
+// i wyszukiwanie w katalogu. Wczytuje katalog z pliku biblioteka.txt i przed
+// przeglądaniem lub wyszukiwaniem dociąga nowe zmiany z dziennika zmian
+// głównego programu.
+// Nigdy nie zapisuje danych.
+// ------------------------------
+class KioskKatalogu {
+private:
+    vector<Ksiazka> katalog;                  // Kopia katalogu
+    unordered_map<string, size_t> indeksNumerow; // Numer książki -> pozycja w katalogu
+    unsigned long long zastosowany = 0;       // Numer ostatniej zastosowanej zmiany
+    unsigned long long pierwszyWDzienniku = 0; // Numer pierwszej zmiany w dzienniku przy ostatnim odczycie
+    streamoff pozycja = 0;                    // Miejsce w dzienniku, od którego czytamy dalej
+    time_t czasOstatniejZmiany = 0;           // Kiedy główny program zrobił ostatnią zastosowaną zmianę
+    time_t czasSynchronizacji = 0;            // Kiedy kiosk ostatnio dociągnął zmiany
+    string plikDanych;                        // Nazwa plików danych bez rozszerzenia
+
+public:
+    KioskKatalogu(const string& plikDanych = "biblioteka") : plikDanych(plikDanych) {
+        wczytajMigawke();
+        czasSynchronizacji = czasTeraz();
+    }
+
+    void uruchom() {
+        int wybor = -1;
+        do {
+            cout << "\n=== KIOSK KATALOGU ===\n"
+                 << "1. Przeglądaj katalog\n"
+                 << "2. Szukaj książki\n"
+                 << "3. Stan replikacji\n"
+                 << "0. Zakończ\n"
+                 << "Wybor: ";
+            string wyborStr;
+            if (!getline(cin, wyborStr)) break;
+            try {
+                wybor = stoi(wyborStr);
+            } catch (...) {
+                cout << "Podaj liczbę!\n";
+                continue;
+            }
+            // Stan replikacji pokazuje zaległość bez dociągania zmian
+            if (wybor != 3) synchronizuj();
+            switch (wybor) {
+                case 1: Bibliotekarz::wyswietlKsiazki(katalog); break;
+                case 2: Bibliotekarz::szukajKsiazki(katalog); break;
+                case 3: wyswietlStanReplikacji(); break;
+                case 0: break;
+                default: cout << "Nieprawidłowy wybór.\n";
+            }
+        } while (wybor != 0);
+    }
+
+private:
+    // Wczytuje katalog z pliku danych razem z numerem zawartej w nim zmiany
+    void wczytajMigawke() {
+        katalog.clear();
+        indeksNumerow.clear();
+        zastosowany = 0;
+        pozycja = 0;
+        pierwszyWDzienniku = 0;
+        ifstream plik(plikDanych + ".txt");
+        string linia, sekcja;
+        while (getline(plik, linia)) {
+            if (linia.rfind("SEQ;", 0) == 0) {
+                try { zastosowany = stoull(linia.substr(4)); } catch (...) { zastosowany = 0; }
+                continue;
+            }
+            if (linia == "KSIAZKI" || linia == "CZYTELNICY") {
+                sekcja = linia;
+                if (sekcja == "CZYTELNICY") break;
+                continue;
+            }
+            if (sekcja == "KSIAZKI") {
+                katalog.push_back(parsujKsiazke(linia));
+                indeksNumerow[katalog.back().getNumer()] = katalog.size() - 1;
+            }
+        }
+    }
+
+    // Odczytuje numer pierwszej zmiany w dzienniku (0 jeśli dziennik jest pusty)
+    static unsigned long long pierwszyNumer(ifstream& dziennik) {
+        string linia;
+        if (!getline(dziennik, linia)) return 0;
+        try { return stoull(linia); } catch (...) { return 0; }
+    }
+
+    // Stosuje zmiany dopisane do dziennika od ostatniego odczytu.
+    // Jeśli dziennik został w międzyczasie wyczyszczony (główny program zapisał dane),
+    // czyta go od początku, a gdy brakuje w nim potrzebnych zmian - wczytuje plik danych ponownie.
+    void synchronizuj() {
+        czasSynchronizacji = czasTeraz();
+        ifstream dziennik(plikDanych + ".zmiany");
+        if (!dziennik) return;
+        dziennik.seekg(0, ios::end);
+        streamoff rozmiar = dziennik.tellg();
+        dziennik.seekg(0);
+        unsigned long long pierwszy = pierwszyNumer(dziennik);
+        if (rozmiar < pozycja || pierwszy != pierwszyWDzienniku) {
+            if (pierwszy == 0 || pierwszy > zastosowany + 1) {
+                wczytajMigawke();
+            }
+            pozycja = 0;
+            pierwszyWDzienniku = pierwszy;
+        }
+        dziennik.clear();
+        dziennik.seekg(pozycja);
+        string linia;
+        while (getline(dziennik, linia)) {
+            if (dziennik.eof()) break; // Niedokończony wiersz - dokończymy przy następnym odczycie
+            pozycja = dziennik.tellg();
+            zastosujZmiane(linia);
+        }
+    }
+
+    // Stosuje jedną zmianę "numer;czas;TYP;pola..." do kopii katalogu
+    void zastosujZmiane(const string& linia) {
+        stringstream ss(linia);
+        string numerStr, czas, typ;
+        getline(ss, numerStr, ';');
+        getline(ss, czas, ';');
+        getline(ss, typ, ';');
+        unsigned long long numer = 0;
+        try { numer = stoull(numerStr); } catch (...) { return; }
+        if (numer <= zastosowany) return;
+        zastosowany = numer;
+        czasOstatniejZmiany = naCzas(czas);
+
+        if (typ == "KSIAZKA") {
+            string tytul, autor, numerKsiazki;
+            getline(ss, tytul, ';');
+            getline(ss, autor, ';');
+            getline(ss, numerKsiazki, ';');
+            katalog.emplace_back(tytul, autor, numerKsiazki);
+            indeksNumerow[numerKsiazki] = katalog.size() - 1;
+        } else if (typ == "WYPOZYCZENIE" || typ == "ZWROT") {
+            string numerKsiazki, login;
+            getline(ss, numerKsiazki, ';');
+            getline(ss, login, ';');
+            auto it = indeksNumerow.find(numerKsiazki);
+            if (it == indeksNumerow.end()) return;
+            if (typ == "WYPOZYCZENIE") katalog[it->second].wypozycz(login, czasOstatniejZmiany);
+            else katalog[it->second].zwroc();
+        } else if (typ == "ODLOZENIE" || typ == "ZWOLNIENIE") {
+            string numerKsiazki, login;
+            getline(ss, numerKsiazki, ';');
+            getline(ss, login, ';');
+            auto it = indeksNumerow.find(numerKsiazki);
+            if (it == indeksNumerow.end()) return;
+            if (typ == "ODLOZENIE") katalog[it->second].odloz(login, czasOstatniejZmiany);
+            else katalog[it->second].zwolnijOdlozenie();
+        }
+        // Zmiany dotyczące czytelników, kar i kolejek rezerwacji nie wpływają na katalog
+    }
+
+    // Numer najnowszej zmiany głównego programu: ostatni pełny wiersz dziennika,
+    // a przy pustym dzienniku numer zmiany zawartej w pliku danych
+    unsigned long long numerGlowny() const {
+        unsigned long long numer = 0;
+        ifstream dziennik(plikDanych + ".zmiany");
+        string linia;
+        while (getline(dziennik, linia)) {
+            if (dziennik.eof()) break; // Niedokończony wiersz nie jest jeszcze zmianą
+            try { numer = stoull(linia); } catch (...) {}
+        }
+        if (numer != 0) return numer;
+        ifstream plik(plikDanych + ".txt");
+        while (getline(plik, linia) && linia != "KSIAZKI") {
+            if (linia.rfind("SEQ;", 0) == 0) {
+                try { numer = stoull(linia.substr(4)); } catch (...) {}
+            }
+        }
+        return numer;
+    }
+
+    // Pokazuje, jak bardzo kopia katalogu odstaje od głównego programu
+    void wyswietlStanReplikacji() const {
+        unsigned long long glowny = numerGlowny();
+        cout << "\n=== STAN REPLIKACJI ===\n"
+             << "Najnowsza zmiana głównego programu: #" << glowny << "\n"
+             << "Zastosowana zmiana: #" << zastosowany << "\n"
+             << "Zaległość: " << (glowny > zastosowany ? glowny - zastosowany : 0) << " zmian\n"
+             << "Ostatnia synchronizacja: " << formatujDateGodzine(czasSynchronizacji) << " ("
+             << static_cast<long long>(difftime(czasTeraz(), czasSynchronizacji)) << " s temu)\n"
+             << "Książek w katalogu: " << katalog.size() << "\n";
+    }
+};
+
+// ------------------------------
+// Klasa BuforWierszy
+// Bufor wejścia podający programowi dane wiersz po wierszu z innego bufora.
+// Przed wydaniem każdego wiersza wywołuje funkcję zwrotną - w tym momencie
+// program skończył obsługę poprzedniego wiersza i czeka na kolejny.
+// ------------------------------
+class BuforWierszy : public streambuf {
+private:
+    streambuf* zrodlo;                       // Skąd czytamy dane
+    function<void(const string&)> poWierszu; // Wywoływana dla każdego wiersza
+    string wiersz;                           // Aktualnie wydawany wiersz
+
+public:
+    BuforWierszy(streambuf* zrodlo, function<void(const string&)> poWierszu)
+        : zrodlo(zrodlo), poWierszu(poWierszu) {}
+
+protected:
+    int underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        wiersz.clear();
+        int znak;
+        while ((znak = zrodlo->sbumpc()) != traits_type::eof() && znak != '\n') {
+            wiersz += static_cast<char>(znak);
+        }
+        if (znak == traits_type::eof() && wiersz.empty()) return traits_type::eof();
+        if (!wiersz.empty() && wiersz.back() == '\r') wiersz.pop_back();
+        poWierszu(wiersz);
+        wiersz += '\n';
+        setg(&wiersz[0], &wiersz[0], &wiersz[0] + wiersz.size());
+        return traits_type::to_int_type(*gptr());
+    }
+};
+
+// ------------------------------
+// Klasa BuforKopiujacy
+// Bufor wyjścia zapamiętujący wszystko, co program wypisał, i opcjonalnie
+// przekazujący to dalej (np. na ekran podczas nagrywania sesji).
+// ------------------------------
+class BuforKopiujacy : public streambuf {
+private:
+    streambuf* cel; // Dokąd przekazać wyjście (nullptr = tylko zapamiętaj)
+    string kopia;   // Całe dotychczasowe wyjście
+
+public:
+    BuforKopiujacy(streambuf* cel = nullptr) : cel(cel) {}
+    const string& getKopia() const { return kopia; }
+
+protected:
+    int overflow(int znak) override {
+        if (znak == traits_type::eof()) return traits_type::not_eof(znak);
+        kopia += static_cast<char>(znak);
+        if (cel && cel->sputc(static_cast<char>(znak)) == traits_type::eof()) return traits_type::eof();
+        return znak;
+    }
+    streamsize xsputn(const char* tekst, streamsize ile) override {
+        kopia.append(tekst, static_cast<size_t>(ile));
+        return cel ? cel->sputn(tekst, ile) : ile;
+    }
+    int sync() override { return cel ? cel->pubsync() : 0; }
+};
+
+// ------------------------------
+// Klasa TestSesji
+// Nagrywanie i odtwarzanie sesji do testów obciążeniowych.
+// Nagranie zapisuje każdy wiersz wejścia z czasem od początku sesji oraz skrót
+// całego wyjścia programu. Odtworzenie podaje te same wiersze - bez przerw albo
+// w nagranym tempie (przyspieszonym 'tempo' razy) - mierzy czas obsługi każdej
+// akcji i sprawdza, czy wyjście się nie zmieniło.
+// Obie operacje działają na świeżo wygenerowanych danych, zatrzymanym zegarze
+// i domyślnych zasadach naliczania kar.
+// Format pliku:
+//   NAGRANIE;<wygenerowanych książek i czytelników>;<czas zegara>
+//   L;<ms od początku>;<wiersz wejścia>
+//   WYJSCIE;<długość>;<skrót>
+// ------------------------------
+class TestSesji {
+private:
+    static constexpr time_t CZAS_TESTOWY = 1700000000; // Stały zegar (14.11.2023)
+    static constexpr const char* PLIK_DANYCH = "sesja_testowa";
+    static constexpr int KOSZT_HASLA_TESTOWY = 4;      // Tanie haszowanie dla wygenerowanych danych
+
+    // Skrót FNV-1a wyjścia programu
+    static uint64_t skrot(const string& tekst) {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char znak : tekst) {
+            h ^= znak;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    // Usuwa dane po poprzednim przebiegu, żeby każdy zaczynał od tych samych danych
+    static void wyczyscDane() {
+        string plik = PLIK_DANYCH;
+        remove((plik + ".txt").c_str());
+        remove((plik + ".txt.tmp").c_str());
+        remove((plik + ".zmiany").c_str());
+        remove((plik + ".rekordy").c_str());
+    }
+
+    // Nazwa akcji dla wiersza wejścia: ostatni nagłówek "=== ... ===" na ekranie
+    // oraz numer wybranej opcji (albo "dane" dla pozostałych wierszy)
+    static string nazwaAkcji(const string& wyjscie, const string& wiersz) {
+        string naglowek = "?";
+        size_t poczatek = wyjscie.rfind("\n=== ");
+        if (poczatek != string::npos) {
+            poczatek += 5;
+            size_t koniec = wyjscie.find(" ===", poczatek);
+            naglowek = wyjscie.substr(poczatek, koniec == string::npos ? string::npos : koniec - poczatek);
+            size_t nawias = naglowek.find(" (");
+            if (nawias != string::npos) naglowek.erase(nawias);
+        }
+        bool wybor = !wiersz.empty() && wiersz.size() <= 2 &&
+                     wiersz.find_first_not_of("0123456789") == string::npos;
+        return naglowek + ": " + (wybor ? wiersz : "dane");
+    }
+
+public:
+    // Nagrywa sesję prowadzoną przez użytkownika na konsoli
+    static int nagraj(const string& sciezka, size_t generowanych) {
+        ofstream plik(sciezka);
+        if (!plik) {
+            cerr << "Nie można utworzyć pliku " << sciezka << "\n";
+            return 1;
+        }
+        plik << "NAGRANIE;" << generowanych << ";" << CZAS_TESTOWY << "\n";
+        ustawStalyCzas(CZAS_TESTOWY);
+        Uzytkownik::kosztHasla = KOSZT_HASLA_TESTOWY;
+        wyczyscDane();
+
+        auto start = chrono::steady_clock::now();
+        BuforWierszy wejscie(cin.rdbuf(), [&](const string& wiersz) {
+            auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+            plik << "L;" << ms << ";" << wiersz << "\n";
+        });
+        BuforKopiujacy wyjscie(cout.rdbuf());
+        streambuf* stareWejscie = cin.rdbuf(&wejscie);
+        streambuf* stareWyjscie = cout.rdbuf(&wyjscie);
+        {
+            SystemBiblioteczny system(PLIK_DANYCH, generowanych, true);
+            system.uruchom();
+        }
+        cout.flush();
+        cin.rdbuf(stareWejscie);
+        cout.rdbuf(stareWyjscie);
+
+        plik << "WYJSCIE;" << wyjscie.getKopia().size() << ";" << hex << skrot(wyjscie.getKopia()) << "\n";
+        wyczyscDane();
+        cout << "Nagranie zapisano w pliku " << sciezka << "\n";
+        return 0;
+    }
+
+    // Odtwarza nagraną sesję 'powtorzen' razy pod rząd i wypisuje raport.
+    // Przy tempie > 0 każdy wiersz jest podawany nie wcześniej niż w nagranym
+    // momencie podzielonym przez tempo (czekanie nie wlicza się do czasu akcji).
+    static int odtworz(const string& sciezka, size_t powtorzen, double tempo = 0) {
+        ifstream plik(sciezka);
+        string linia, wejscie, oczekiwanySkrot;
+        size_t generowanych = 0, oczekiwanaDlugosc = 0, wierszy = 0;
+        vector<double> momenty; // Nagrany moment każdego wiersza (ms od początku sesji)
+        time_t czas = CZAS_TESTOWY;
+        while (getline(plik, linia)) {
+            stringstream ss(linia);
+            string typ, pole1, pole2;
+            getline(ss, typ, ';');
+            getline(ss, pole1, ';');
+            getline(ss, pole2);
+            if (typ == "NAGRANIE") {
+                generowanych = static_cast<size_t>(naKwote(pole1));
+                czas = naCzas(pole2);
+            } else if (typ == "L") {
+                wejscie += pole2 + "\n";
+                momenty.push_back(naKwote(pole1));
+                ++wierszy;
+            } else if (typ == "WYJSCIE") {
+                oczekiwanaDlugosc = static_cast<size_t>(naKwote(pole1));
+                oczekiwanySkrot = pole2;
+            }
+        }
+        if (oczekiwanySkrot.empty()) {
+            cerr << "Plik " << sciezka << " nie jest poprawnym nagraniem sesji.\n";
+            return 1;
+        }
+
+        map<string, vector<double>> czasyAkcji; // Nazwa akcji -> czasy obsługi w ms
+        vector<double> wszystkie;
+        size_t rozbieznosci = 0;
+        RaportPamieci pamiec; // Pamięć danych na koniec ostatniego przebiegu
+        auto startCalosci = chrono::steady_clock::now();
+
+        Uzytkownik::kosztHasla = KOSZT_HASLA_TESTOWY;
+        // Format liczb ustawiony w jednym przebiegu (np. fixed) nie może przejść na następny
+        ios formatPoczatkowy(nullptr);
+        formatPoczatkowy.copyfmt(cout);
+        for (size_t przebieg = 0; przebieg < powtorzen; ++przebieg) {
+            ustawStalyCzas(czas);
+            wyczyscDane();
+            istringstream zrodlo(wejscie);
+            BuforKopiujacy wyjscie;
+            string akcja = "uruchomienie";
+            auto startPrzebiegu = chrono::steady_clock::now();
+            auto poprzedni = startPrzebiegu;
+            size_t numerWiersza = 0;
+            auto zapiszCzas = [&](const string& nastepna) {
+                auto teraz = chrono::steady_clock::now();
+                double ms = chrono::duration<double, milli>(teraz - poprzedni).count();
+                czasyAkcji[akcja].push_back(ms);
+                wszystkie.push_back(ms);
+                akcja = nastepna;
+                poprzedni = teraz;
+            };
+            BuforWierszy bufor(zrodlo.rdbuf(), [&](const string& wiersz) {
+                zapiszCzas(nazwaAkcji(wyjscie.getKopia(), wiersz));
+                if (tempo > 0 && numerWiersza < momenty.size()) {
+                    this_thread::sleep_until(startPrzebiegu + chrono::duration_cast<chrono::steady_clock::duration>(
+                                                                  chrono::duration<double, milli>(momenty[numerWiersza] / tempo)));
+                    poprzedni = chrono::steady_clock::now();
+                }
+                ++numerWiersza;
+            });
+            cout.copyfmt(formatPoczatkowy);
+            streambuf* stareWejscie = cin.rdbuf(&bufor);
+            streambuf* stareWyjscie = cout.rdbuf(&wyjscie);
+            cin.clear();
+            {
+                SystemBiblioteczny system(PLIK_DANYCH, generowanych, true);
+                system.uruchom();
+                if (przebieg + 1 == powtorzen) pamiec = system.raportPamieci();
+                zapiszCzas("zapis danych");
+            }
+            zapiszCzas("");
+            cin.rdbuf(stareWejscie);
+            cout.rdbuf(stareWyjscie);
+            cout.copyfmt(formatPoczatkowy);
+            cin.clear();
+
+            stringstream skrotHex;
+            skrotHex << hex << skrot(wyjscie.getKopia());
+            if (wyjscie.getKopia().size() != oczekiwanaDlugosc || skrotHex.str() != oczekiwanySkrot) {
+                ++rozbieznosci;
+                ofstream(sciezka + ".rozbieznosc.txt") << wyjscie.getKopia();
+            }
+        }
+        double calosc = chrono::duration<double>(chrono::steady_clock::now() - startCalosci).count();
+        ustawStalyCzas(0);
+        wyczyscDane();
+
+        cout << "\n=== RAPORT ODTWORZENIA ===\n"
+             << "Nagranie: " << sciezka << " (" << wierszy << " wierszy, " << generowanych << " wygenerowanych)\n"
+             << "Przebiegi: " << powtorzen << ", czas: " << fixed << setprecision(3) << calosc << " s\n"
+             << "Przepustowość: " << setprecision(1) << (calosc > 0 ? powtorzen / calosc : 0.0) << " sesji/s, "
+             << (calosc > 0 ? powtorzen * wierszy / calosc : 0.0) << " akcji/s\n\n"
+             << left << setw(40) << "Akcja" << right << setw(8) << "Liczba"
+             << setw(12) << "Śr. [ms]" << setw(12) << "p99 [ms]" << setw(12) << "Maks [ms]" << "\n";
+        auto wypiszWiersz = [](const string& nazwa, vector<double>& czasy) {
+            sort(czasy.begin(), czasy.end());
+            double suma = 0;
+            for (double c : czasy) suma += c;
+            cout << left << setw(40) << nazwa << right << setw(8) << czasy.size() << setprecision(3)
+                 << setw(12) << suma / czasy.size()
+                 << setw(12) << czasy[min(czasy.size() - 1, czasy.size() * 99 / 100)]
+                 << setw(12) << czasy.back() << "\n";
+        };
+        for (auto& wpis : czasyAkcji) wypiszWiersz(wpis.first, wpis.second);
+        wypiszWiersz("Wszystkie akcje", wszystkie);
+        cout << "\nPamięć danych po ostatnim przebiegu:\n";
+        pamiec.wypisz(cout);
+        if (rozbieznosci > 0) {
+            cout << "\nBŁĄD: wyjście różni się od nagrania w " << rozbieznosci << " z " << powtorzen
+                 << " przebiegów (ostatnie zapisano w " << sciezka << ".rozbieznosc.txt)\n";
+            return 1;
+        }
+        cout << "\nWyjście zgodne z nagraniem we wszystkich przebiegach.\n";
+        return 0;
+    }
+
+    // Mierzy logowanie pod obciążeniem: 'ile' prób logowania zleconych naraz
+    // do puli weryfikacji, przy haszowaniu o podanym koszcie
+    static int testLogowania(size_t ile, int koszt) {
+        Uzytkownik::kosztHasla = koszt;
+        const size_t kont = 64;
+        vector<shared_ptr<Uzytkownik>> konta;
+        for (size_t i = 0; i < kont; ++i) {
+            auto konto = make_shared<Czytelnik>("Czytelnik", "Testowy", "", "", "czytelnik" + to_string(i) + "@bib.pl");
+            konto->ustawHaslo("haslo" + to_string(i));
+            konta.push_back(konto);
+        }
+
+        PulaWeryfikacji pula;
+        vector<chrono::steady_clock::time_point> zlecone(ile);
+        vector<future<bool>> wyniki;
+        wyniki.reserve(ile);
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < ile; ++i) {
+            zlecone[i] = chrono::steady_clock::now();
+            wyniki.push_back(pula.zlec(konta[i % kont], "haslo" + to_string(i % kont)));
+        }
+        // Czas logowania: od zlecenia do odebrania wyniku (wyniki odbieramy po kolei)
+        vector<double> czasy;
+        size_t bledne = 0;
+        for (size_t i = 0; i < ile; ++i) {
+            if (!wyniki[i].get()) ++bledne;
+            czasy.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - zlecone[i]).count());
+        }
+        double calosc = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        sort(czasy.begin(), czasy.end());
+
+        cout << "\n=== TEST LOGOWANIA ===\n"
+             << "Logowań: " << ile << " (naraz), koszt haszowania: " << koszt
+             << ", wątków: " << max(1u, thread::hardware_concurrency()) << "\n"
+             << "Czas: " << fixed << setprecision(3) << calosc << " s, przepustowość: "
+             << setprecision(1) << (calosc > 0 ? ile / calosc : 0.0) << " logowań/s\n"
+             << setprecision(3) << "Czas logowania [ms]: mediana " << czasy[czasy.size() / 2]
+             << ", p99 " << czasy[min(czasy.size() - 1, czasy.size() * 99 / 100)]
+             << ", maks " << czasy.back() << "\n";
+        if (bledne > 0) {
+            cout << "BŁĄD: " << bledne << " poprawnych haseł zostało odrzuconych.\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Sprawdza wczytanie pliku w najstarszym formacie (wiersze W: z tytułem, książki
+    // bez wypożyczającego): przeterminowana książka musi dostać wypożyczającego,
+    // a kara musi zostać naliczona już przy starcie, bez logowania czytelnika.
+    static int testMigracji() {
+        const int DNI_WYPOZYCZENIA = 20; // Domyślnie: 6 dni po 14 dniach bez kary po 1 zł
+        const double OCZEKIWANA_KARA = 6.0;
+        const string login = "jan@czytelnik.pl";
+        ustawStalyCzas(CZAS_TESTOWY);
+        Uzytkownik::kosztHasla = KOSZT_HASLA_TESTOWY;
+        wyczyscDane();
+        time_t wypozyczono = CZAS_TESTOWY - DNI_WYPOZYCZENIA * 60 * 60 * 24;
+        ofstream(string(PLIK_DANYCH) + ".txt")
+            << "KSIAZKI\n"
+            << "W pustyni i w puszczy;Henryk Sienkiewicz;1234567890;0\n"
+            << "Lalka;Bolesław Prus;2345678901;1\n"
+            << "CZYTELNICY\n"
+            << "BIB;admin@bib.pl;admin\n"
+            << "Jan;Kowalski;" << login << ";123456789;" << login << ";0;1234\n"
+            << "W:W pustyni i w puszczy;01.11.2023;1;" << wypozyczono << "\n"
+            << "W:Lalka;" << formatujDate(wypozyczono) << ";0;" << wypozyczono << "\n";
+        {
+            SystemBiblioteczny system(PLIK_DANYCH, 0, true);
+        }
+
+        // Zapisany plik pokazuje stan po starcie: wypożyczającego książki i saldo czytelnika
+        string wypozyczajacy, linia, sekcja;
+        double saldo = -1;
+        ifstream plik(string(PLIK_DANYCH) + ".txt");
+        while (getline(plik, linia)) {
+            if (!linia.empty() && linia.back() == '\r') linia.pop_back();
+            if (linia == "KSIAZKI" || linia == "CZYTELNICY" || linia == "REZERWACJE") {
+                sekcja = linia;
+            } else if (sekcja == "KSIAZKI" && linia.rfind("Lalka;", 0) == 0) {
+                wypozyczajacy = parsujKsiazke(linia).getWypozyczajacy();
+            } else if (sekcja == "CZYTELNICY" && linia.rfind("Jan;", 0) == 0) {
+                stringstream ss(linia);
+                string pole;
+                for (int i = 0; i < 6; ++i) getline(ss, pole, ';');
+                saldo = naKwote(pole);
+            }
+        }
+        plik.close();
+        ustawStalyCzas(0);
+        wyczyscDane();
+
+        cout << "\n=== TEST MIGRACJI ===\n"
+             << "Wypożyczający książki: " << (wypozyczajacy.empty() ? "(brak)" : wypozyczajacy) << "\n"
+             << "Saldo kar po starcie: " << fixed << setprecision(2) << saldo << " zł (oczekiwane "
+             << OCZEKIWANA_KARA << " zł)\n";
+        if (wypozyczajacy != login || fabs(saldo - OCZEKIWANA_KARA) > 0.005) {
+            cout << "BŁĄD: stary plik danych został wczytany niepoprawnie.\n";
+            return 1;
+        }
+        return 0;
+    }
 };
+
 // ------------------------------
 // Funkcja main
 // Punkt wejścia do programu. Tworzy system biblioteczny i uruchamia główną pętlę.
+// Argumenty:
+//   --kiosk                      przeglądarka katalogu tylko do odczytu
+//   --nagraj <plik> [N]          nagranie sesji na danych z N wygenerowanymi książkami i czytelnikami
+//   --odtworz <plik> [powtórzeń] [tempo]
+//                                odtworzenie nagrania z raportem czasów; tempo > 0 zachowuje
+//                                nagrane odstępy między wierszami (2 = dwa razy szybciej)
+//   --test-logowania [N] [koszt] N logowań naraz przez pulę weryfikacji haseł
+//                                (domyślny koszt - kosztHasla z ustawienia.cfg)
+//   --test-migracji              wczytanie pliku danych w najstarszym formacie
 // ------------------------------
-int main() {
+int main(int argc, char* argv[]) {
+    string tryb = argc > 1 ? argv[1] : "";
+    if (tryb == "--kiosk") {
+        KioskKatalogu kiosk;
+        kiosk.uruchom();
+        return 0;
+    }
+    if (tryb == "--test-logowania") {
+        size_t ile = argc > 2 ? static_cast<size_t>(naKwote(argv[2])) : 1000;
+        Ustawienia ustawienia;
+        ustawienia.wczytaj("ustawienia.cfg");
+        int koszt = argc > 3 ? static_cast<int>(naKwote(argv[3])) : ustawienia.kosztHasla;
+        return TestSesji::testLogowania(max<size_t>(ile, 1), max(0, min(koszt, 24)));
+    }
+    if (tryb == "--test-migracji") return TestSesji::testMigracji();
+    if ((tryb == "--nagraj" || tryb == "--odtworz") && argc > 2) {
+        size_t liczba = argc > 3 ? static_cast<size_t>(naKwote(argv[3])) : 0;
+        if (tryb == "--nagraj") return TestSesji::nagraj(argv[2], liczba);
+        double tempo = argc > 4 ? naKwote(argv[4]) : 0.0;
+        return TestSesji::odtworz(argv[2], max<size_t>(liczba, 1), tempo);
+    }
     SystemBiblioteczny system;
     system.uruchom();
     return 0;